@@ -1,67 +1,13 @@
 #include "annotator.h"
 #include "ThreadPool.h"
 
-std::set<std::pair<int32_t, int32_t>>::iterator Annotator::getFirstOverlap(const std::set<std::pair<int32_t, int32_t>>& s, const std::pair<int32_t, int32_t>&p){
-    auto itsv= std::upper_bound(s.begin(), s.end(), p);
-    auto upIter = itsv;
-    if(itsv != s.begin()){
-        auto lowIter = --itsv;
-        bool lowGet = false;
-        while(p.first <= lowIter->second){
-            if(itsv == s.begin()){
-                return itsv;
-            }
-            --lowIter;
-            lowGet = true;
-        }
-        if(lowGet){
-            return ++lowIter;
-        }
-    }
-    bool upGet = false;
-    while(upIter != s.end() && p.second >= upIter->first){
-        ++upIter;
-        upGet = true;
-    }
-    if(upGet){
-        return --upIter;
-    }
-    return s.end();
-}
-
-Stats* Annotator::covAnnotate(std::vector<SVRecord>& svs){
+Stats* Annotator::covAnnotate(std::vector<SVRecord>& svs, const OnePassStore* store){
     // Open file handler
     samFile* fp = sam_open(mOpt->bamfile.c_str(), "r");
+    mOpt->attachThreadPool(fp);
     hts_set_fai_filename(fp, mOpt->genome.c_str());
     bam_hdr_t* h = sam_hdr_read(fp);
-    faidx_t* fai = fai_load(mOpt->genome.c_str());
     hts_idx_t* idx = sam_index_load(fp, mOpt->bamfile.c_str());
-    // Find Ns in reference genome
-    util::loginfo("Starting gathering N regions in reference");
-    std::vector<std::set<std::pair<int32_t, int32_t>>> nreg(h->n_targets);
-    for(auto& refIndex : mOpt->svRefID){
-        int32_t refSeqLen = -1;
-        char* seq = faidx_fetch_seq(fai, h->target_name[refIndex], 0, h->target_len[refIndex], &refSeqLen);
-        bool nrun = false;
-        int nstart = refSeqLen;
-        for(int32_t i = 0; i < refSeqLen; ++i){
-            if(seq[i] != 'N' || seq[i] != 'n'){
-                if(nrun){
-                    nreg[refIndex].insert(std::make_pair(nstart, i - 1));
-                    nrun = false;
-                }
-            }else{
-                if(!nrun){
-                    nstart = i;
-                    nrun = true;
-                }
-            }
-        }
-        // Insert last possible Ns region
-        if(nrun) nreg[refIndex].insert(std::make_pair(nstart, refSeqLen - 1));
-        if(seq) free(seq);
-    }
-    util::loginfo("Finish gathering N regions in reference");
     util::loginfo("Start extracting left/middle/right regions for each SV");
     // Add control regions
     std::vector<std::vector<CovRecord>> covRecs(h->n_targets); //coverage records of 3-part of each SV events
@@ -74,11 +20,12 @@ Stats* Annotator::covAnnotate(std::vector<SVRecord>& svs){
         covLeft.mID = lastID + itsv->mID;
         covLeft.mStart = std::max(0, itsv->mSVStart - halfsize);
         covLeft.mEnd = itsv->mSVStart;
-        auto itp = getFirstOverlap(nreg[itsv->mChr1], {covLeft.mStart, covLeft.mEnd});
-        while(itp != nreg[itsv->mChr1].end()){
+        // Move control region before N gaps overlapped, gaps are half-open so the same gap is never hit again
+        const std::vector<NGap>& gaps1 = mOpt->nGaps->gaps(h->target_name[itsv->mChr1]);
+        const NGap* itp = NULL;
+        while((itp = NGapIndex::firstOverlap(gaps1, covLeft.mStart, covLeft.mEnd))){
             covLeft.mStart = std::max(itp->first - halfsize, 0);
             covLeft.mEnd = itp->first;
-            itp = getFirstOverlap(nreg[itsv->mChr1], {covLeft.mStart, covLeft.mEnd});
         }
         covRecs[itsv->mChr1].push_back(covLeft);
         // Actual SV region
@@ -98,11 +45,11 @@ Stats* Annotator::covAnnotate(std::vector<SVRecord>& svs){
         covRight.mID = 2 * lastID + itsv->mID;
         covRight.mStart = itsv->mSVEnd;
         covRight.mEnd = std::min((int32_t)h->target_len[itsv->mChr2], itsv->mSVEnd + halfsize);
-        itp = getFirstOverlap(nreg[itsv->mChr2], {covRight.mStart, covRight.mEnd});
-        while(itp != nreg[itsv->mChr2].end()){
+        // Move control region after N gaps overlapped
+        const std::vector<NGap>& gaps2 = mOpt->nGaps->gaps(h->target_name[itsv->mChr2]);
+        while((itp = NGapIndex::firstOverlap(gaps2, covRight.mStart, covRight.mEnd))){
             covRight.mStart = itp->second;
             covRight.mEnd = itp->second + halfsize;
-            itp = getFirstOverlap(nreg[itsv->mChr2], {covRight.mStart, covRight.mEnd});
         }
         covRecs[itsv->mChr2].push_back(covRight);
     }
@@ -159,23 +106,42 @@ Stats* Annotator::covAnnotate(std::vector<SVRecord>& svs){
     // Clean-up
     sam_close(fp);
     hts_idx_destroy(idx);
-    fai_destroy(fai);
-    // Translocation quality and clip status recorders
-    std::unordered_map<size_t, uint8_t> transQuals;
-    std::unordered_map<size_t, bool> transClips;
-    // Get coverage from each contig in parallel
-    ThreadPool::ThreadPool pool(std::min(mOpt->nthread, (int32_t)mOpt->svRefID.size()));
-    std::vector<Stats*> covStats(mOpt->svRefID.size());
-    std::vector<std::future<void>> statRets(mOpt->svRefID.size());
-    int32_t i = 0;
-    for(auto& refidx: mOpt->svRefID){
-        covStats[i] = new Stats(mOpt, svs.size(), refidx);
-        statRets[i] = pool.enqueue(&Stats::stat, covStats[i], std::ref(svs), std::ref(covRecs), std::ref(bpRegion), std::ref(spanPoint), std::ref(transQuals), std::ref(transClips));
-        ++i;
+    // Get coverage from each tile in parallel, reads collected on scanning tiles are replayed in one pass mode
+    TileList tiles;
+    if(store){
+        for(auto& tile: store->mTiles){
+            if(mOpt->svRefID.find(tile.mTid) != mOpt->svRefID.end()) tiles.push_back(tile);
+        }
+    }else{
+        RegionList covRegs(mOpt->contigNum);
+        for(auto& refIndex: mOpt->svRefID) covRegs[refIndex].insert({0, (int32_t)h->target_len[refIndex]});
+        tiles = TileScheduler::split(covRegs, mOpt->tileSize);
+    }
+    ThreadPool::ThreadPool pool(std::max(1, std::min(mOpt->nthread, (int32_t)tiles.size())));
+    std::vector<Stats*> covStats(tiles.size(), NULL);
+    std::vector<std::future<void>> statRets(tiles.size());
+    uint32_t maxTask = 2 * mOpt->nthread;
+    uint32_t nextTile = 0;
+    // Merge coverage of each tile in tile order, so the result is irrelevant to threads used
+    Stats* finalStat = new Stats(svs.size());
+    finalStat->mOpt = mOpt;
+    for(uint32_t i = 0; i < tiles.size(); ++i){
+        for(; nextTile < tiles.size() && nextTile < i + maxTask; ++nextTile){
+            covStats[nextTile] = new Stats(mOpt, svs.size(), tiles[nextTile]);
+            covStats[nextTile]->mStore = store;
+            covStats[nextTile]->mCountFragments = (store == NULL);
+            statRets[nextTile] = pool.enqueue(&Stats::stat, covStats[nextTile], std::ref(svs), std::ref(covRecs), std::ref(bpRegion), std::ref(spanPoint));
+        }
+        statRets[i].get();
+        finalStat->merge(covStats[i]);
+        delete covStats[i];
+        covStats[i] = NULL;
     }
-    for(auto& e: statRets) e.get();
-    Stats* finalStat = Stats::merge(covStats, svs.size());
-    for(auto& e: covStats) delete e;
+    finalStat->mCountFragments = (store == NULL);
+    finalStat->statPending(covRecs, spanPoint);
+    if(store) finalStat->countFragments(covRecs, store);
+    finalStat->countReads(svs);
+    bam_hdr_destroy(h);
     return finalStat;
 }
 
@@ -184,6 +150,7 @@ void Annotator::geneAnnotate(SVSet& svs, GeneInfoList& gl){
     std::vector<std::string> vstr;
     kstring_t rec = {0, 0, 0};
     htsFile* fp = hts_open(mOpt->annodb.c_str(), "r");
+    mOpt->attachThreadPool(fp);
     tbx_t* tbx = tbx_index_load(mOpt->annodb.c_str());
     for(uint32_t i = 0; i < svs.size(); ++i){
         gl[i].mChr1 = svs[i].mNameChr1;
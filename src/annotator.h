@@ -22,8 +22,9 @@ class Annotator{
 
         /** annotate SV coverage
          * @param svs reference of SVRecords
+         * @param store records collected in one pass mode, reads are fetched from bam if NULL
          */
-        Stats* covAnnotate(SVSet& svs);
+        Stats* covAnnotate(SVSet& svs, const OnePassStore* store = NULL);
 
         /** annotate SV gene information
          * @param svs reference of SVRecords
@@ -31,12 +32,6 @@ class Annotator{
          */
         void geneAnnotate(SVSet& svs, GeneInfoList& gl);
 
-        /** get first overlap of an region against an region set
-         * @param s region sets
-         * @param p region to query
-         * @return iterator to an region overlap with p or end
-         */
-        static std::set<std::pair<int32_t, int32_t>>::iterator getFirstOverlap(const std::set<std::pair<int32_t, int32_t>>& s, const std::pair<int32_t, int32_t>& p);
 };
 
 #endif
@@ -7,9 +7,11 @@
 void Stats::reportBCF(const SVSet& svs){
     // Open file handler
     samFile* samfp = sam_open(mOpt->bamfile.c_str(), "r");
+    mOpt->attachThreadPool(samfp);
     hts_set_fai_filename(samfp, mOpt->genome.c_str());
     bam_hdr_t* bamhdr = sam_hdr_read(samfp);
     htsFile* fp = bcf_open(mOpt->bcfOut.c_str(), "wb");
+    mOpt->attachThreadPool(fp);
     bcf_hdr_t* hdr = bcf_hdr_init("w");
     // Output bcf header
     bcf_hdr_append(hdr, "##ALT=<ID=DEL,Description=\"Deletion\">");
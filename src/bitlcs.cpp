@@ -0,0 +1,101 @@
+#include <algorithm>
+#include "bitlcs.h"
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define BITLCS_X86 1
+#endif
+
+BitLCS::BitLCS(const char* s, int m){
+    mLen = m;
+    mWords = std::max(1, (m + 63) / 64);
+    mLastMask = (m % 64) ? ((1ULL << (m % 64)) - 1) : ~0ULL;
+    if(m == 0) mLastMask = 0;
+    memset(mIdx, 0, sizeof(mIdx));
+    mMasks.assign(mWords, 0);
+    int nbase = 0;
+    for(int i = 0; i < m; ++i){
+        uint8_t c = s[i];
+        if(!mIdx[c]){
+            mIdx[c] = ++nbase;
+            mMasks.resize((size_t)(nbase + 1) * mWords, 0);
+        }
+        mMasks[(size_t)mIdx[c] * mWords + i / 64] |= (1ULL << (i % 64));
+    }
+}
+
+int BitLCS::lcs(const char* t, int n) const {
+    if(mWords == 1){
+        uint64_t v = ~0ULL;
+        for(int k = 0; k < n; ++k){
+            uint64_t u = v & *mask(t[k]);
+            v = (v + u) | (v - u);
+        }
+        return zeros(&v, 1);
+    }
+    std::vector<uint64_t> v(mWords, ~0ULL);
+    for(int k = 0; k < n; ++k){
+        const uint64_t* m = mask(t[k]);
+        uint64_t carry = 0;
+        for(int w = 0; w < mWords; ++w){
+            uint64_t u = v[w] & m[w];
+            uint64_t x = v[w] + u;
+            uint64_t c = x < v[w];
+            uint64_t y = x + carry;
+            carry = c | (y < x);
+            v[w] = y | (v[w] - u);
+        }
+    }
+    return zeros(v.data(), 1);
+}
+
+void BitLCS::lcs4(const char* const* t, const int* n, int* ret) const {
+#ifdef BITLCS_X86
+    if(avx2()){
+        lcs4AVX2(t, n, ret);
+        return;
+    }
+#endif
+    for(int l = 0; l < 4; ++l) ret[l] = lcs(t[l], n[l]);
+}
+
+bool BitLCS::avx2(){
+#ifdef BITLCS_X86
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#ifdef BITLCS_X86
+__attribute__((target("avx2")))
+void BitLCS::lcs4AVX2(const char* const* t, const int* n, int* ret) const {
+    // Lane l of each word holds V of text l, texts shorter than others are padded by an all zero mask which keeps V
+    int maxn = std::max(std::max(n[0], n[1]), std::max(n[2], n[3]));
+    std::vector<uint64_t> v(4 * mWords, ~0ULL);
+    const __m256i sign = _mm256_set1_epi64x(0x8000000000000000LL);
+    const uint64_t* m[4];
+    for(int k = 0; k < maxn; ++k){
+        for(int l = 0; l < 4; ++l) m[l] = k < n[l] ? mask(t[l][k]) : mMasks.data();
+        __m256i carry = _mm256_setzero_si256();
+        for(int w = 0; w < mWords; ++w){
+            __m256i mw = _mm256_set_epi64x(m[3][w], m[2][w], m[1][w], m[0][w]);
+            __m256i vw = _mm256_loadu_si256((const __m256i*)&v[4 * w]);
+            __m256i u = _mm256_and_si256(vw, mw);
+            __m256i x = _mm256_add_epi64(vw, u);
+            __m256i y = _mm256_add_epi64(x, carry);
+            // Unsigned compare by flipping sign bits, carry out if x < vw or y < x
+            __m256i c1 = _mm256_cmpgt_epi64(_mm256_xor_si256(vw, sign), _mm256_xor_si256(x, sign));
+            __m256i c2 = _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign), _mm256_xor_si256(y, sign));
+            carry = _mm256_srli_epi64(_mm256_or_si256(c1, c2), 63);
+            vw = _mm256_or_si256(y, _mm256_andnot_si256(mw, vw));
+            _mm256_storeu_si256((__m256i*)&v[4 * w], vw);
+        }
+    }
+    for(int l = 0; l < 4; ++l) ret[l] = zeros(v.data() + l, 4);
+}
+#else
+void BitLCS::lcs4AVX2(const char* const* t, const int* n, int* ret) const {
+    for(int l = 0; l < 4; ++l) ret[l] = lcs(t[l], n[l]);
+}
+#endif
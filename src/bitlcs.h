@@ -0,0 +1,75 @@
+#ifndef BITLCS_H
+#define BITLCS_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+/** class to compute longest common subsequence length of one pattern against many texts bit-parallel\n
+ * Allison-Dix/Hyyro algorithm, one bit per pattern position packed into 64-bit words,\n
+ * each text base updates all words of the bit vector V by V = (V + (V & M)) | (V & ~M), M is match mask of base\n
+ * LCS length is the number of zero bits in V after all text bases processed, in O(ceil(m/64) * n) time
+ */
+class BitLCS{
+    public:
+        int mLen;                     ///< length of pattern
+        int mWords;                   ///< 64-bit words of one match mask
+        uint8_t mIdx[256];            ///< index of match mask of each base, 0 for bases not in pattern
+        std::vector<uint64_t> mMasks; ///< match masks of each distinct base in pattern, the first one all zero
+        uint64_t mLastMask;           ///< valid bits of the last word
+
+    public:
+        /** BitLCS constructor
+         * @param s bases of pattern
+         * @param m length of pattern
+         */
+        BitLCS(const char* s, int m);
+
+        /** BitLCS destructor */
+        ~BitLCS(){}
+
+        /** get longest common subsequence length of pattern and an text
+         * @param t bases of text
+         * @param n length of text
+         * @return longest common subsequence length
+         */
+        int lcs(const char* t, int n) const;
+
+        /** get longest common subsequence length of pattern and 4 texts at once, AVX2 is used if supported by CPU
+         * @param t bases of each text
+         * @param n length of each text
+         * @param ret array to store longest common subsequence length of each text
+         */
+        void lcs4(const char* const* t, const int* n, int* ret) const;
+
+        /** test whether lcs4 runs on AVX2
+         * @return true if AVX2 supported by compiler and CPU
+         */
+        static bool avx2();
+
+    private:
+        /** get match mask of an base
+         * @param c base
+         * @return pointer to mWords words of match mask
+         */
+        inline const uint64_t* mask(char c) const {
+            return mMasks.data() + (size_t)mIdx[(uint8_t)c] * mWords;
+        }
+
+        /** count longest common subsequence length from zero bits of V
+         * @param v mWords words of bit vector V, stride words apart
+         * @param stride distance between two words of v
+         * @return number of zero bits in the lower mLen bits of v
+         */
+        inline int zeros(const uint64_t* v, int stride) const {
+            int ones = 0;
+            for(int w = 0; w < mWords - 1; ++w) ones += __builtin_popcountll(v[w * stride]);
+            ones += __builtin_popcountll(v[(mWords - 1) * stride] & mLastMask);
+            return mLen - ones;
+        }
+
+        /** AVX2 implementation of lcs4 */
+        void lcs4AVX2(const char* const* t, const int* n, int* ret) const;
+};
+
+#endif
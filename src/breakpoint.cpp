@@ -14,63 +14,65 @@ void BreakPoint::init(int32_t largeChrLen, int32_t smallChrLen){
     }
 }
 
-std::string BreakPoint::getSVRef(const char* smallChrSeq, const char* largeChrSeq){
+std::string BreakPoint::getSVRef(const RefStore* ref, const bam_hdr_t* hdr){
+    const char* smallChr = hdr->target_name[mChr2];
+    const char* largeChr = hdr->target_name[mChr1];
     std::string chr2Part;
     // Get chr2 seq for tranclocation
     if(mSVT == 5){
-        chr2Part = std::string(smallChrSeq + mSVEndBeg, smallChrSeq + mSVEndEnd);
+        chr2Part = ref->slice(smallChr, mSVEndBeg, mSVEndEnd);
         util::reverseComplement(chr2Part);
     }else if(mSVT > 5){
-        chr2Part = std::string(smallChrSeq + mSVEndBeg, smallChrSeq + mSVEndEnd);
+        chr2Part = ref->slice(smallChr, mSVEndBeg, mSVEndEnd);
         util::str2upper(chr2Part);
     }
     // Get full ref seq for translocation
     if(mSVT >= 5){
         if(mSVT == 5 || mSVT == 7){// 5to5 || 5to3
-            std::string chr1Part = std::string(largeChrSeq + mSVStartBeg, largeChrSeq + mSVStartEnd);
+            std::string chr1Part = ref->slice(largeChr, mSVStartBeg, mSVStartEnd);
             util::str2upper(chr1Part);
             return chr1Part + chr2Part;
         }else if(mSVT == 6){// 3to3
-            std::string chr1Part = std::string(largeChrSeq + mSVStartBeg, largeChrSeq + mSVStartEnd);
+            std::string chr1Part = ref->slice(largeChr, mSVStartBeg, mSVStartEnd);
             util::reverseComplement(chr1Part);
             return chr1Part + chr2Part;
         }else{// 3to5
-            std::string chr1Part = std::string(largeChrSeq + mSVStartBeg, largeChrSeq + mSVStartEnd);
+            std::string chr1Part = ref->slice(largeChr, mSVStartBeg, mSVStartEnd);
             util::str2upper(chr1Part);
             return chr2Part + chr1Part;
         }
     }
     // Get full ref seq for SV on same chr
     if(mSVT == 0){// 5to5 left breakpoint of inversion
-        std::string refEnd = std::string(smallChrSeq + mSVEndBeg, smallChrSeq + mSVEndEnd);
+        std::string refEnd = ref->slice(smallChr, mSVEndBeg, mSVEndEnd);
         util::reverseComplement(refEnd);
-        std::string refBeg = std::string(smallChrSeq + mSVStartBeg, smallChrSeq + mSVStartEnd);
+        std::string refBeg = ref->slice(smallChr, mSVStartBeg, mSVStartEnd);
         util::str2upper(refBeg);
         return refBeg + refEnd;
     }
     if(mSVT == 1){// 3to3 right breakpoing of inversion
-        std::string refBeg = std::string(smallChrSeq + mSVStartBeg, smallChrSeq + mSVStartEnd);
+        std::string refBeg = ref->slice(smallChr, mSVStartBeg, mSVStartEnd);
         util::reverseComplement(refBeg);
-        std::string refEnd = std::string(smallChrSeq + mSVEndBeg, smallChrSeq + mSVEndEnd);
+        std::string refEnd = ref->slice(smallChr, mSVEndBeg, mSVEndEnd);
         util::str2upper(refEnd);
         return refBeg + refEnd;
     }
     if(mSVT == 2){// 5to3 Deletion
-        std::string refBeg = std::string(smallChrSeq + mSVStartBeg, smallChrSeq + mSVStartEnd);
-        std::string refEnd = std::string(smallChrSeq + mSVEndBeg, smallChrSeq + mSVEndEnd);
+        std::string refBeg = ref->slice(smallChr, mSVStartBeg, mSVStartEnd);
+        std::string refEnd = ref->slice(smallChr, mSVEndBeg, mSVEndEnd);
         util::str2upper(refBeg);
         util::str2upper(refEnd);
         return refBeg + refEnd;
     }
     if(mSVT == 3){// 3to5 Duplication
-        std::string refBeg = std::string(smallChrSeq + mSVStartBeg, smallChrSeq + mSVStartEnd);
-        std::string refEnd = std::string(smallChrSeq + mSVEndBeg, smallChrSeq + mSVEndEnd);
+        std::string refBeg = ref->slice(smallChr, mSVStartBeg, mSVStartEnd);
+        std::string refEnd = ref->slice(smallChr, mSVEndBeg, mSVEndEnd);
         util::str2upper(refBeg);
         util::str2upper(refEnd);
         return refEnd + refBeg;
     }
     if(mSVT == 4){// Insertion
-        std::string refSeq = std::string(smallChrSeq + mSVStartBeg, smallChrSeq + mSVEndEnd);
+        std::string refSeq = ref->slice(smallChr, mSVStartBeg, mSVEndEnd);
         util::str2upper(refSeq);
         return refSeq;
     }
@@ -5,6 +5,7 @@
 #include <string>
 #include <htslib/sam.h>
 #include "svrecord.h"
+#include "refstore.h"
 
 /** class to store and analysis breakpoint of an SV */
 class BreakPoint{
@@ -82,11 +83,11 @@ class BreakPoint{
         void init(int32_t largeChrLen, int32_t smallChrLen);
         
         /** get sample reference sequence spanning an SV breakpoint[mSVStartBeg, mSVEndEnd]
-         * @param smallChrSeq mChr2  total sequence
-         * @param largeChrSeq mChr1 total sequence
+         * @param ref pointer to RefStore to fetch mChr1/mChr2 slices from
+         * @param hdr bam header
          * @return contructed sample reference sequence spanning an SV breakpoint
          */
-        std::string getSVRef(const char* smallChrSeq = NULL, const char* largeChrSeq = NULL);
+        std::string getSVRef(const RefStore* ref, const bam_hdr_t* hdr);
 
 };
 
@@ -159,141 +159,142 @@ int DPBamRecord::getSVType(const bam1_t* b, Options* opt){
 
 void DPBamRecordSet::cluster(std::vector<DPBamRecord> &dps, SVSet &svs, int32_t svt){
     if(dps.empty()) return;
-    // Sort DPBamRecords
-    std::sort(dps.begin(), dps.end());
-    // Components
-    std::vector<int32_t> comp = std::vector<int32_t>(dps.size(), 0);
-    // Edge lists for each component
-    std::map<int32_t, std::vector<EdgeRecord>> compEdge;
-    int32_t compNum = 0;
-    size_t lastConnectedNodesEnd = 0;
-    size_t lastConnectedNodesBeg = 0;
-    for(uint32_t i = 0; i < dps.size(); ++i){
-        // Safe to clean the graph
-        if(i > lastConnectedNodesEnd){
-            // Clean edge lists
-            if(!compEdge.empty()){
-                searchCliques(compEdge, dps, svs, svt);
-                compEdge.clear();
-            }
+    mNextMember.resize(dps.size());
+    // Sort DPBamRecords, then group them by (mCurTid, mMateTid), DPBamRecords in one group keep their coordinate order
+    RadixSorter::sort(dps, [](const DPBamRecord& dp){return dp.sortKey();}, 8, mOpt->nthread);
+    RadixSorter::sort(dps, [](const DPBamRecord& dp){return ((uint32_t)dp.mCurTid << 16) | dp.mMateTid;}, 4, mOpt->nthread);
+    for(size_t beg = 0, end = 0; beg < dps.size(); beg = end){
+        for(end = beg + 1; end < dps.size() && dps[end].mCurTid == dps[beg].mCurTid && dps[end].mMateTid == dps[beg].mMateTid; ++end);
+        // Subsample hyper-dense regions so clustering cost of pathological loci is bounded
+        std::vector<DenseRegion> dense;
+        size_t kept = DenseSampler::subsample(dps, beg, end, [](const DPBamRecord& dp){return dp.minCoord();}, mOpt->libInfo->mVarisize,
+                                              mOpt->filterOpt->mMaxEvidenceDensity, ((uint64_t)svt << 32) | ((uint32_t)dps[beg].mCurTid << 16) | dps[beg].mMateTid, dense);
+        for(auto& dr : dense){
+            util::loginfo("Dense DP region of SV type " + std::to_string(svt) + " at " + std::to_string(dps[beg].mCurTid) + ":" + std::to_string(dr.mBeg) + "-" + std::to_string(dr.mEnd) +
+                          " subsampled, " + std::to_string(dr.mDropped) + " of " + std::to_string(dr.mRecords) + " DPs dropped");
         }
-        // Try to expand components
+        if(kept - beg > 1) sweepCliques(dps, beg, kept, svs, svt);
+    }
+}
+
+void DPBamRecordSet::sweepCliques(std::vector<DPBamRecord>& dps, size_t beg, size_t end, SVSet& svs, int32_t svt){
+    int32_t chr1 = dps[beg].mCurTid;
+    int32_t chr2 = dps[beg].mMateTid;
+    std::vector<DPClique>& active = mActive; // cliques whose seed is still in range of current DP
+    active.clear();
+    mGroup.clear();
+    mGroupOpen.clear();
+    mGroupLargest.clear();
+    for(size_t i = beg; i < end; ++i){
         int32_t mincrd = dps[i].minCoord();
         int32_t maxcrd = dps[i].maxCoord();
-        for(uint32_t j = i + 1; j < dps.size(); ++j){
-            // Check that mate chr agree
-            if(dps[i].mCurTid != dps[j].mCurTid) continue;
-            // Check two DP leftmost mapping position falling in reasonable range
-            if(std::abs(dps[j].minCoord() + dps[j].mCurAlen - mincrd) > mOpt->libInfo->mVarisize) break;
-            // Check two DP rightmost mapping position falling in reasonable range
-            if(std::abs(dps[j].maxCoord() - maxcrd) + mOpt->libInfo->mReadLen > mOpt->libInfo->mMaxNormalISize) break;
-            // Update last connected node
-            if(j > lastConnectedNodesEnd) lastConnectedNodesEnd = j;
-            // Assign components
-            int32_t compIndex = 0;
-            if(!comp[i]){
-                if(!comp[j]){// Neither vertex has component assigned
-                    compIndex = ++compNum;
-                    comp[i] = compIndex;
-                    comp[j] = compIndex;
-                    compEdge.insert(std::make_pair(compIndex, std::vector<EdgeRecord>()));
-                }else{// Only one vertex has component assigned
-                    compIndex = comp[j];
-                    comp[i] = compIndex;
-                }
-            }else{
-                if(!comp[j]){// Only one veretx has comopnent assigned
-                    compIndex = comp[i];
-                    comp[j] = compIndex;
-                }else{// Both vertices have component assigned
-                    if(comp[i] == comp[j]) compIndex = comp[i];
-                    else{// Merge components
-                        compIndex = comp[i];
-                        int32_t otherIndex = comp[j];
-                        if(otherIndex < compIndex){
-                            compIndex = comp[j];
-                            otherIndex = comp[i];
-                        }
-                        // Re-label other index
-                        for(size_t k = lastConnectedNodesBeg; k <= lastConnectedNodesEnd; ++k){
-                            if(otherIndex == comp[i]) comp[i] = compIndex;
-                        }
-                        // Merge edge lists
-                        auto compIdxIter = compEdge.find(compIndex);
-                        auto otherIdxIter = compEdge.find(otherIndex);
-                        compIdxIter->second.insert(compIdxIter->second.end(), otherIdxIter->second.begin(), otherIdxIter->second.end());
-                        compEdge.erase(otherIdxIter);
-                    }
-                }
+        // Close cliques whose seed leftmost mapping position is out of range
+        size_t kept = 0;
+        for(size_t k = 0; k < active.size(); ++k){
+            if(std::abs(mincrd + dps[i].mCurAlen - active[k].mSeedMin) > mOpt->libInfo->mVarisize) closeClique(active[k], dps, chr1, chr2, svs, svt);
+            else{
+                if(kept != k) std::swap(active[kept], active[k]);
+                ++kept;
             }
-            // Append new edge
-            auto compEdgeIter = compEdge.find(compIndex);
-            if(compEdgeIter->second.size() < mOpt->filterOpt->mGraphPruning){
-                int32_t weight = std::abs(std::abs(dps[i].minCoord() - dps[j].minCoord()) - std::abs(dps[i].maxCoord() - dps[j].maxCoord()));
-                compEdgeIter->second.push_back(EdgeRecord(i, j, weight));
+        }
+        active.resize(kept);
+        // Find cliques this DP agrees with, extend the one with closest seed
+        mCompatible.clear();
+        int32_t best = -1;
+        int32_t bestWeight = 0;
+        for(size_t k = 0; k < active.size(); ++k){
+            // Check rightmost mapping position of DP and seed falling in reasonable range
+            if(std::abs(maxcrd - active[k].mSeedMax) + mOpt->libInfo->mReadLen > mOpt->libInfo->mMaxNormalISize) continue;
+            int32_t svStart = active[k].mSVStart;
+            int32_t svEnd = active[k].mSVEnd;
+            int32_t wiggle = active[k].mWiggle;
+            if(!dps[i].updateClique(svStart, svEnd, wiggle, svt)) continue;
+            mCompatible.push_back(k);
+            int32_t weight = std::abs(std::abs(mincrd - active[k].mSeedMin) - std::abs(maxcrd - active[k].mSeedMax));
+            if(best >= 0 && weight >= bestWeight) continue;
+            best = k;
+            bestWeight = weight;
+        }
+        if(best >= 0){
+            DPClique& c = active[best];
+            dps[i].updateClique(c.mSVStart, c.mSVEnd, c.mWiggle, svt);
+            mNextMember[c.mTail] = i;
+            c.mTail = i;
+            ++c.mSize;
+            // Singleton seeds this DP does not join are not linked, so scattered DPs do not chain distinct SVs
+            for(auto& k : mCompatible){
+                if((int32_t)k != best && active[k].mSize >= 2) mergeGroup(c.mId, active[k].mId);
             }
+            continue;
         }
+        // Start a new clique seeded by this DP
+        DPClique c;
+        c.mSeedMin = mincrd;
+        c.mSeedMax = maxcrd;
+        dps[i].initClique(c.mSVStart, c.mSVEnd, c.mWiggle, mOpt, svt);
+        if(chr1 == chr2 && c.mSVStart >= c.mSVEnd) continue; // do not support SV
+        c.mHead = c.mTail = i;
+        c.mSize = 1;
+        c.mId = mGroup.size();
+        mGroup.push_back(c.mId);
+        mGroupOpen.push_back(1);
+        mGroupLargest.push_back(DPClique());
+        mGroupLargest.back().mSize = 0;
+        active.push_back(c);
     }
-    if(!compEdge.empty()){
-        searchCliques(compEdge, dps, svs, svt);
-        compEdge.clear();
-    }
+    for(auto& c : active) closeClique(c, dps, chr1, chr2, svs, svt);
 }
 
-void DPBamRecordSet::searchCliques(std::map<int32_t, std::vector<EdgeRecord>>& compEdge, std::vector<DPBamRecord>& dps, SVSet& svs, int32_t svt){
-    // Iterate all components
-    for(auto compIter = compEdge.begin(); compIter != compEdge.end(); ++compIter){
-        // Sort edges by weight
-        std::sort(compIter->second.begin(), compIter->second.end());
-        // Find a large clique
-        auto edgeIter = compIter->second.begin();
-        std::set<int32_t> clique, incompatible;
-        int32_t svStart = -1;
-        int32_t svEnd = -1;
-        int32_t wiggle = 0;
-        int32_t chr1 = dps[edgeIter->mSource].mCurTid;
-        int32_t chr2 = dps[edgeIter->mSource].mMateTid;
-        dps[edgeIter->mSource].initClique(svStart, svEnd, wiggle, mOpt, svt);
-        if(chr1 == chr2 && svStart >= svEnd) continue; // do not support SV
-        clique.insert(edgeIter->mSource);
-        // Grow the clique
-        ++edgeIter;
-        for(; edgeIter != compIter->second.end(); ++edgeIter){
-            int32_t v;
-            if(clique.find(edgeIter->mSource) == clique.end() && clique.find(edgeIter->mTarget) != clique.end()){
-                v = edgeIter->mSource;
-            }else if(clique.find(edgeIter->mSource) != clique.end() && clique.find(edgeIter->mTarget) == clique.end()){
-                v = edgeIter->mTarget;
-            }else continue;
-            if(incompatible.find(v) != incompatible.end()) continue;
-            if(dps[v].updateClique(svStart, svEnd, wiggle, svt)) clique.insert(v);
-            else incompatible.insert(v);
-        }
-        if(clique.size() > 1 && validSVSize(svStart, svEnd, svt)){
-            SVRecord svr;
-            svr.mChr1 = chr1;
-            svr.mChr2 = chr2;
-            svr.mSVStart = svStart + 1;
-            svr.mSVEnd = svEnd + 1;
-            svr.mPESupport = clique.size();
-            int32_t ciwiggle = std::max(std::abs(wiggle), 50);
-            svr.mCiPosLow = -ciwiggle;
-            svr.mCiPosHigh = ciwiggle;
-            svr.mCiEndLow = -ciwiggle;
-            svr.mCiEndHigh = ciwiggle;
-            std::vector<uint8_t> mapQV(clique.size(), 0);
-            int qIdx = 0;
-            for(auto& e : clique) mapQV[qIdx++] = dps[e].mMapQual;
-            svr.mPEMapQuality = statutil::median(mapQV);
-            svr.mSRSupport = 0;
-            svr.mSRAlignQuality = 0;
-            svr.mPrecise = 0;
-            svr.mSVT = svt;
-            svr.mInsLen = 0;
-            svr.mHomLen = 0;
-            svs.push_back(svr);
-        }
+void DPBamRecordSet::mergeGroup(int32_t a, int32_t b){
+    a = findGroup(a);
+    b = findGroup(b);
+    if(a == b) return;
+    if(b < a) std::swap(a, b);
+    mGroup[b] = a;
+    mGroupOpen[a] += mGroupOpen[b];
+    const DPClique& l = mGroupLargest[b];
+    if(l.mSize > mGroupLargest[a].mSize || (l.mSize && l.mSize == mGroupLargest[a].mSize && l.mHead < mGroupLargest[a].mHead)) mGroupLargest[a] = l;
+}
+
+void DPBamRecordSet::closeClique(const DPClique& c, const std::vector<DPBamRecord>& dps, int32_t chr1, int32_t chr2, SVSet& svs, int32_t svt){
+    int32_t g = findGroup(c.mId);
+    DPClique& l = mGroupLargest[g];
+    if(c.mSize >= 2 && validSVSize(c.mSVStart, c.mSVEnd, svt)){
+        // Larger clique wins, the earlier seeded one on ties
+        if(c.mSize > l.mSize || (c.mSize == l.mSize && c.mHead < l.mHead)) l = c;
     }
+    // Groups only merge through open cliques, so a group with none open is final
+    if(--mGroupOpen[g] == 0 && l.mSize) reportClique(l, dps, chr1, chr2, svs, svt);
+}
+
+void DPBamRecordSet::reportClique(const DPClique& c, const std::vector<DPBamRecord>& dps, int32_t chr1, int32_t chr2, SVSet& svs, int32_t svt){
+    if(c.mSize < 2 || !validSVSize(c.mSVStart, c.mSVEnd, svt)) return;
+    SVRecord svr;
+    svr.mChr1 = chr1;
+    svr.mChr2 = chr2;
+    svr.mSVStart = c.mSVStart + 1;
+    svr.mSVEnd = c.mSVEnd + 1;
+    svr.mPESupport = c.mSize;
+    int32_t ciwiggle = std::max(std::abs(c.mWiggle), 50);
+    svr.mCiPosLow = -ciwiggle;
+    svr.mCiPosHigh = ciwiggle;
+    svr.mCiEndLow = -ciwiggle;
+    svr.mCiEndHigh = ciwiggle;
+    // Median mapping quality of DPs in clique
+    uint32_t qualCount[256] = {0};
+    size_t v = c.mHead;
+    for(uint32_t k = 0; k < c.mSize; ++k, v = mNextMember[v]) ++qualCount[dps[v].mMapQual];
+    uint32_t rank = c.mSize / 2;
+    uint32_t medQual = 0;
+    for(uint32_t seen = qualCount[0]; seen <= rank; seen += qualCount[++medQual]);
+    svr.mPEMapQuality = medQual;
+    svr.mSRSupport = 0;
+    svr.mSRAlignQuality = 0;
+    svr.mPrecise = 0;
+    svr.mSVT = svt;
+    svr.mInsLen = 0;
+    svr.mHomLen = 0;
+    svs.push_back(svr);
 }
 
 void DPBamRecordSet::cluster(SVSet& svs){
@@ -7,28 +7,29 @@
 #include <htslib/sam.h>
 #include "options.h"
 #include "svrecord.h"
-#include "edgerecord.h"
+#include "radixsort.h"
+#include "subsample.h"
 
-/** Class to store discordant pair of reads alignment record which supports SVs */
+/** Class to store discordant pair of reads alignment record which supports SVs, packed into 24 bytes\n
+ * SV type supported is implied by the bucket of DPBamRecordSet::mDPs the record is stored in
+ */
 class DPBamRecord{
     public:
-        int32_t mCurTid;   ///< current read(second read in coordinate sorted bam) bam record reference id b->core.tid
         int32_t mCurPos;   ///< current read(second read in coordinate sorted bam) bam record mapping starting pos b->core.pos
-        int32_t mMateTid;  ///< mate read(first read in coordinate sorted bam) bam record reference id b->core.mtid
         int32_t mMatePos;  ///< mate read(first read in coordinate sorted bam) bam record mapping starting pos b->core.mpos
         int32_t mCurAlen;  ///< current read(second read in coordinate sorted bam) bam record consumed reference length bam_cigar2rlen(b)
         int32_t mMateAlen; ///< mate read(first read in coordinate sorted bam) bam record consumed reference length bam_cigar2rlen(mateb)
+        uint16_t mCurTid;  ///< current read(second read in coordinate sorted bam) bam record reference id b->core.tid
+        uint16_t mMateTid; ///< mate read(first read in coordinate sorted bam) bam record reference id b->core.mtid
         uint8_t mMapQual;  ///< std::min(b->core.qual, mate->core.qual)
-        int32_t mSVT;      ///< SV type this DPBamRecord supports
 
     public:
         /** DPBamRecord constructor
          * @param b pointer to bam1_t struct(one read in a pair mapping at higher position or larger chromosome)
          * @param mateAlen mate read bam record consumed reference length bam_cigar2rlen(mateb)
          * @param mapQual std::min(b->core.qual, mate->core.qual)
-         * @param svt SV type this DPBamRecord supports
          */
-        DPBamRecord(const bam1_t* b, int32_t mateAlen, uint8_t mapQual, int32_t svt){
+        DPBamRecord(const bam1_t* b, int32_t mateAlen, uint8_t mapQual){
             mCurTid = b->core.tid;
             mCurPos = b->core.pos;
             mMateTid = b->core.mtid;
@@ -36,7 +37,6 @@ class DPBamRecord{
             mCurAlen = bam_cigar2rlen(b->core.n_cigar, bam_get_cigar(b));
             mMateAlen = mateAlen;
             mMapQual = mapQual;
-            mSVT = svt;
         }
 
         /** DPBamRecord destructor */
@@ -49,14 +49,13 @@ class DPBamRecord{
          */
         inline friend std::ostream& operator<<(std::ostream& os, const DPBamRecord& dpr){
             os << "=======================================\n";
-            os << "SVT: " << dpr.mSVT << "\n";
             os << "Current Read Tid: " << dpr.mCurTid << "\n";
             os << "Current Read Mapping Pos: " << dpr.mCurPos << "\n";
             os << "Current Read Reference Consumed: " << dpr.mCurAlen << "\n";
             os << "Mate Read Tid: " << dpr.mMateTid << "\n";
             os << "Mate Read Mapping Pos: " << dpr.mMatePos << "\n";
             os << "Mate Read Reference Consumed: " << dpr.mMateAlen << "\n";
-            os << "Min Mapping Quality of Pair: " << dpr.mMapQual << "\n";
+            os << "Min Mapping Quality of Pair: " << (int)dpr.mMapQual << "\n";
             os << "=======================================\n";
             return os;
         }
@@ -69,14 +68,17 @@ class DPBamRecord{
          * @return true if this DPBamRecord object < other
          */
         inline bool operator<(const DPBamRecord& other) const {
-            if(mCurTid == mMateTid){
-                return std::min(mCurPos, mMatePos) < std::min(other.mCurPos, other.mMatePos) ||
-                       (std::min(mCurPos, mMatePos) == std::min(other.mCurPos, other.mMatePos) && 
-                        std::max(mCurPos, mMatePos) < std::max(other.mCurPos, other.mMatePos));
-            }else{
-                return (mCurPos < other.mCurPos) || 
-                       (mCurPos == other.mCurPos && mMatePos < other.mMatePos);
-            }
+            return sortKey() < other.sortKey();
+        }
+
+        /** get sort key of an DP, which packs (minCoord, maxCoord) into one 64-bit word\n
+         * DPs of one SV type are either all on same chr or all on different chr, so ordering by this key\n
+         * is the same as ordering by leftmost and then rightmost mapping position on same chr\n
+         * and by mCurPos and then mMatePos on different chr
+         * @return sort key of DP
+         */
+        inline uint64_t sortKey() const {
+            return ((uint64_t)(uint32_t)minCoord() << 32) | (uint32_t)maxCoord();
         }
 
         /** return minimal coordinate of an DP\n
@@ -139,11 +141,30 @@ class DPBamRecord{
 
 };
 
+/** class to store an clique of DPBamRecords being grown */
+struct DPClique{
+    int32_t mSeedMin;               ///< minCoord of seed DPBamRecord
+    int32_t mSeedMax;               ///< maxCoord of seed DPBamRecord
+    int32_t mSVStart;               ///< SV starting position agreed by all DPBamRecords in clique
+    int32_t mSVEnd;                 ///< SV ending position agreed by all DPBamRecords in clique
+    int32_t mWiggle;                ///< wiggle left for DPBamRecords to join
+    uint32_t mSize;                 ///< DPBamRecords in clique
+    size_t mHead;                   ///< index of the first DPBamRecord in clique, others are chained by DPBamRecordSet::mNextMember
+    size_t mTail;                   ///< index of the last DPBamRecord in clique
+    int32_t mId;                    ///< index of clique in DPBamRecordSet::mGroup
+};
+
 /** class to store and analysis DPBamRecords */ 
 class DPBamRecordSet{
     public:
         Options* mOpt;///< pointer to Options object
         std::vector<std::vector<DPBamRecord>> mDPs;///< DPBamRecord supporting various types of SVs
+        std::vector<DPClique> mActive;             ///< cliques being grown, reused across sweeps
+        std::vector<size_t> mNextMember;           ///< index of next DPBamRecord in the same clique
+        std::vector<int32_t> mGroup;               ///< union-find parent of each clique, cliques sharing an DPBamRecord compatible with both are in one group
+        std::vector<int32_t> mGroupOpen;           ///< cliques of group still being grown, valid for group root
+        std::vector<DPClique> mGroupLargest;       ///< largest reportable clique closed in group, valid for group root, mSize 0 if none
+        std::vector<size_t> mCompatible;           ///< active cliques current DPBamRecord agrees with
     
     public:
         /** DPBamRecordSet constructor
@@ -181,16 +202,21 @@ class DPBamRecordSet{
          * @param svt SV type this bam record supports
          */
         inline void insertDP(const bam1_t* b, int32_t mateAlen, uint8_t mapQual, int32_t svt){
-            mDPs[svt].push_back(DPBamRecord(b, mateAlen, mapQual, svt));
+            mDPs[svt].push_back(DPBamRecord(b, mateAlen, mapQual));
+        }
+
+        /** move all DPBamRecords of another DPBamRecordSet to the end of this DPBamRecordSet
+         * @param other pointer to DPBamRecordSet to merge from
+         */
+        inline void merge(DPBamRecordSet* other){
+            for(uint32_t i = 0; i < mDPs.size(); ++i){
+                mDPs[i].insert(mDPs[i].end(), other->mDPs[i].begin(), other->mDPs[i].end());
+                std::vector<DPBamRecord>().swap(other->mDPs[i]);
+            }
         }
 
-        /** cluster sorted DPBamRecords of one type SV and find all supporting SV of this type\n
-         * step1: cluster DPBamRecord into different component, DPBamRecord with same chr1 and starting and ending\n
-         *        mapping positions are in reasonable range(only considering nearing two) consists a component
-         * step2: search each component for an clique, use edge with smallest weight as seed,\n
-         *        this edge have the smallest leftmost and rightmost coordinates offset between src and dest\n
-         *        initialize SV starting/ending wiggling(maximum mapping pos offset beetween an clique) in a\n
-         *        SV type specific way, then expand this clique as big as possible\n
+        /** cluster DPBamRecords of one type SV and find all supporting SV of this type\n
+         * DPBamRecords are sorted and grouped by (mCurTid, mMateTid), cliques of each group are grown by sweepCliques
          * @param dps a list of DPBamRecord which supporting one kind of SV type
          * @param svs SVSet to store SV supporting by DPs
          * @param svt only cluster this type of SV supporting DPBamRecords
@@ -202,13 +228,56 @@ class DPBamRecordSet{
          */
         void cluster(SVSet& svs);
         
-        /** a subroutine used to search all possible clique supporting an type of SV
-         * @param compEdge <compNumber, components> pairs clustered from DPBamRecords
-         * @param dps reference of DPBamRecordSet list which supporting one kind of SV
+        /** grow cliques of DPBamRecords on one (mCurTid, mMateTid) pair in one sweep without building edges\n
+         * each DPBamRecord joins the open clique whose seed is closest to it(smallest leftmost and rightmost coordinates offset)\n
+         * among cliques it agrees with, or seeds a new clique if none, a clique is closed once the sweep leaves range of its seed\n
+         * the joined clique is merged into one group with each other clique of at least 2 DPBamRecords the DPBamRecord also agrees with,\n
+         * a group is finished once all its cliques closed, then only its largest clique is reported, so one SV per connected component of DPs
+         * @param dps reference of DPBamRecord list which supporting one kind of SV
+         * @param beg index of the first DPBamRecord on the pair
+         * @param end index past the last DPBamRecord on the pair
+         * @param svs SVSet to store SV supporting by DPs
+         * @param svt SV type analyzed
+         */
+        void sweepCliques(std::vector<DPBamRecord>& dps, size_t beg, size_t end, SVSet& svs, int32_t svt);
+
+        /** get root of the group of an clique
+         * @param id index of clique in mGroup
+         * @return index of group root
+         */
+        inline int32_t findGroup(int32_t id){
+            while(mGroup[id] != id){
+                mGroup[id] = mGroup[mGroup[id]];
+                id = mGroup[id];
+            }
+            return id;
+        }
+
+        /** merge groups of two cliques, the earlier created root is kept
+         * @param a index of clique in mGroup
+         * @param b index of clique in mGroup
+         */
+        void mergeGroup(int32_t a, int32_t b);
+
+        /** close an clique, report the largest clique of its group if all cliques of group closed
+         * @param c reference of DPClique closed
+         * @param dps reference of DPBamRecord list which supporting one kind of SV
+         * @param chr1 reference id of SV starting position
+         * @param chr2 reference id of SV ending position
+         * @param svs SVSet to store SV
+         * @param svt SV type analyzed
+         */
+        void closeClique(const DPClique& c, const std::vector<DPBamRecord>& dps, int32_t chr1, int32_t chr2, SVSet& svs, int32_t svt);
+
+        /** report an clique as an SV if supported by at least 2 DPs
+         * @param c reference of DPClique
+         * @param dps reference of DPBamRecord list the clique grown from
+         * @param chr1 reference id of current reads
+         * @param chr2 reference id of mate reads
          * @param svs SVSet to store SV supporting by DPs
          * @param svt SV type analyzed
          */
-        void searchCliques(std::map<int32_t, std::vector<EdgeRecord>>& compEdge, std::vector<DPBamRecord>& dps, SVSet& svs, int32_t svt);
+        void reportClique(const DPClique& c, const std::vector<DPBamRecord>& dps, int32_t chr1, int32_t chr2, SVSet& svs, int32_t svt);
        
         /** check whether SV size is valid 
          * @param svStart SV starting position
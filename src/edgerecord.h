@@ -1,8 +1,10 @@
 #ifndef EDGERECORD_H
 #define EDGERECORD_H
 
-#include <map>
+#include <vector>
 #include <cstdint>
+#include <algorithm>
+#include <utility>
 #include <iostream>
 
 /** class to store cluster relationship bewteen nodes\n
@@ -50,7 +52,143 @@ struct EdgeRecord{
     }
 };
 
-/** type to store an raw cluster of SR/DP */
-typedef std::map<int32_t, std::vector<EdgeRecord>> Cluster;
+/** class to track which components have been merged, component labels start from 1\n
+ * merged components are labeled by the smaller label of the two
+ */
+class UnionFind{
+    public:
+        std::vector<int32_t> mParent; ///< parent label of each label, label 0 is not used
+
+    public:
+        /** UnionFind constructor */
+        UnionFind(){
+            mParent.push_back(0);
+        }
+
+        /** UnionFind destructor */
+        ~UnionFind(){}
+
+        /** create a new component
+         * @return label of new component
+         */
+        inline int32_t add(){
+            mParent.push_back(mParent.size());
+            return mParent.back();
+        }
+
+        /** find current label of an component
+         * @param x label of component
+         * @return label of component x merged into
+         */
+        inline int32_t find(int32_t x){
+            while(mParent[x] != x){
+                mParent[x] = mParent[mParent[x]];
+                x = mParent[x];
+            }
+            return x;
+        }
+
+        /** merge two components
+         * @param a current label of one component
+         * @param b current label of another component
+         * @return label of merged component, the smaller one of a and b
+         */
+        inline int32_t unite(int32_t a, int32_t b){
+            if(b < a) std::swap(a, b);
+            mParent[b] = a;
+            return a;
+        }
+
+        /** remove all components */
+        inline void clear(){
+            mParent.resize(1);
+        }
+};
+
+/** class to hold buffers reused while searching cliques of components one by one, so no heap allocation is needed per component\n
+ * vertices of an component are given local ids in [0, n), clique and incompatible vertices are marked by stamps of current component
+ */
+class CliqueScratch{
+    public:
+        std::vector<uint32_t> mMark;     ///< stamp of each local vertex
+        uint32_t mStamp = 0;             ///< stamp of clique vertices of current component, mStamp + 1 marks incompatible vertices
+        std::vector<uint32_t> mCount;    ///< weight counts of counting sort
+        std::vector<EdgeRecord> mEdges;  ///< edges of current component sorted by weight
+
+    public:
+        /** CliqueScratch constructor */
+        CliqueScratch(){}
+
+        /** CliqueScratch destructor */
+        ~CliqueScratch(){}
+
+        /** start an new component, all vertices are unmarked
+         * @param n vertices of component
+         */
+        inline void reset(size_t n){
+            if(mMark.size() < n) mMark.resize(n, 0);
+            if(mStamp >= UINT32_MAX - 2){
+                std::fill(mMark.begin(), mMark.end(), 0);
+                mStamp = 0;
+            }
+            mStamp += 2;
+        }
+
+        /** test whether an vertex is in clique
+         * @param v local id of vertex
+         * @return true if v is in clique
+         */
+        inline bool inClique(int32_t v) const {
+            return mMark[v] == mStamp;
+        }
+
+        /** test whether an vertex is incompatible with clique
+         * @param v local id of vertex
+         * @return true if v is incompatible
+         */
+        inline bool incompatible(int32_t v) const {
+            return mMark[v] == mStamp + 1;
+        }
+
+        /** add an vertex to clique
+         * @param v local id of vertex
+         */
+        inline void addClique(int32_t v){
+            mMark[v] = mStamp;
+        }
+
+        /** mark an vertex incompatible with clique
+         * @param v local id of vertex
+         */
+        inline void addIncompatible(int32_t v){
+            mMark[v] = mStamp + 1;
+        }
+
+        /** sort edges of an component into mEdges in the same order as EdgeRecord::operator<\n
+         * counting sort on weight is used if weights span a range not much larger than edges, then edges of equal weight are ordered by vertices
+         * @param edges edges of an component
+         */
+        inline void sortEdges(const std::vector<EdgeRecord>& edges){
+            mEdges.assign(edges.begin(), edges.end());
+            if(edges.empty()) return;
+            int32_t minW = edges[0].mWeight, maxW = edges[0].mWeight;
+            for(auto& e: edges){
+                minW = std::min(minW, e.mWeight);
+                maxW = std::max(maxW, e.mWeight);
+            }
+            size_t range = (size_t)((int64_t)maxW - minW) + 1;
+            if(range > 4 * edges.size() + 1024){
+                std::sort(mEdges.begin(), mEdges.end());
+                return;
+            }
+            mCount.assign(range + 1, 0);
+            for(auto& e: edges) ++mCount[e.mWeight - minW + 1];
+            for(size_t w = 1; w <= range; ++w) mCount[w] += mCount[w - 1];
+            for(auto& e: edges) mEdges[mCount[e.mWeight - minW]++] = e;
+            for(size_t w = 0, b = 0; w < range; b = mCount[w++]){
+                if(mCount[w] - b > 1) std::sort(mEdges.begin() + b, mEdges.begin() + mCount[w]);
+            }
+        }
+};
 
 #endif
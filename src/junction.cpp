@@ -1,16 +1,73 @@
 #include "junction.h"
+#include "ThreadPool.h"
 
 bool JunctionMap::insertJunction(const bam1_t* b){
-    bool inserted = false;
-    bool fw = !(b->core.flag & BAM_FREVERSE);
+    bool primary = !(b->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY));
+    // Capture sequence of primary read
+    int32_t readIdx = primary ? mReadStore.size() : -1;
+    bool inserted = appendJunctions(svutil::hashString(bam_get_qname(b)), !(b->core.flag & BAM_FREVERSE), b->core.tid, b->core.pos,
+                                    primary, readIdx, bam_get_cigar(b), b->core.n_cigar, mJunctions);
+    if(inserted && primary) mReadStore.add(b);
+    return inserted;
+}
+
+bool JunctionMap::getSplitJunctions(const bam1_t* b, const std::vector<SplitPart>& parts, std::vector<Junction>& jcts){
+    jcts.clear();
     size_t seed = svutil::hashString(bam_get_qname(b));
-    int32_t refpos = b->core.pos;
+    int32_t readIdx = mReadStore.size();
+    bool inserted = appendJunctions(seed, !(b->core.flag & BAM_FREVERSE), b->core.tid, b->core.pos, true, readIdx, bam_get_cigar(b), b->core.n_cigar, jcts);
+    for(auto& part: parts){
+        appendJunctions(seed, part.mForward, part.mTid, part.mPos, false, -1, part.mCigar.data(), part.mCigar.size(), jcts);
+    }
+    if(inserted) mReadStore.add(b);
+    std::sort(jcts.begin(), jcts.end());
+    return !jcts.empty();
+}
+
+bool JunctionMap::parseSA(const bam1_t* b, const bam_hdr_t* h, std::vector<SplitPart>& parts){
+    parts.clear();
+    const uint8_t* saptr = bam_aux_get(b, "SA");
+    if(!saptr) return false;
+    const char* sa = bam_aux2Z(saptr);
+    if(!sa) return false;
+    // SA:Z:(rname,pos,strand,CIGAR,mapQ,NM;)+
+    std::vector<std::string> vstr;
+    std::vector<std::string> fields;
+    util::split(sa, vstr, ";");
+    for(auto& e: vstr){
+        if(e.empty()) continue;
+        util::split(e, fields, ",");
+        if(fields.size() < 6) return false;
+        SplitPart part;
+        part.mTid = bam_name2id(const_cast<bam_hdr_t*>(h), fields[0].c_str());
+        if(part.mTid < 0) return false;
+        part.mPos = std::atoi(fields[1].c_str()) - 1;
+        part.mForward = (fields[2] == "+");
+        if(std::atoi(fields[4].c_str()) < mOpt->filterOpt->minMapQual) return false;
+        const char* p = fields[3].c_str();
+        while(*p){
+            char* q = NULL;
+            long oplen = std::strtol(p, &q, 10);
+            if(q == p || !*q) return false;
+            const char* op = std::strchr(BAM_CIGAR_STR, *q);
+            if(!op) return false;
+            part.mCigar.push_back(bam_cigar_gen(oplen, op - BAM_CIGAR_STR));
+            p = q + 1;
+        }
+        if(part.mCigar.empty()) return false;
+        // Part outside valid regions is never scanned, so the read is left to insertJunction as if SA tag absent
+        if(!inValidRegion(part.mTid, part.mPos, part.mPos + bam_cigar2rlen(part.mCigar.size(), part.mCigar.data()))) return false;
+        parts.push_back(part);
+    }
+    return !parts.empty();
+}
+
+bool JunctionMap::appendJunctions(size_t seed, bool fw, int32_t tid, int32_t pos, bool primary, int32_t readIdx, const uint32_t* cigar, uint32_t ncigar, std::vector<Junction>& jcts){
+    bool inserted = false;
+    int32_t refpos = pos;
     int32_t seqpos = 0, readpos = 0;
-    int32_t readStart = refpos;
-    if(b->core.flag & (BAM_FSECONDARY | BAM_FSUPPLEMENTARY)) readStart = -1;
-    uint32_t* cigar = bam_get_cigar(b);
-    int32_t seqlen = bam_cigar2qlen(b->core.n_cigar, cigar);
-    for(uint32_t i = 0; i < b->core.n_cigar; ++i){
+    int32_t seqlen = bam_cigar2qlen(ncigar, cigar);
+    for(uint32_t i = 0; i < ncigar; ++i){
         int opint = bam_cigar_op(cigar[i]);
         int oplen = bam_cigar_oplen(cigar[i]);
         if(opint == BAM_CMATCH || opint == BAM_CEQUAL || opint == BAM_CDIFF){
@@ -19,16 +76,16 @@ bool JunctionMap::insertJunction(const bam1_t* b){
         }else if(opint == BAM_CDEL){
             readpos = (seqpos <= seqlen && !fw) ? seqlen - seqpos : seqpos;
             if(oplen > mOpt->filterOpt->mMinRefSep){
-                mJunctionReads[seed].push_back(Junction(fw, false, b->core.tid, readStart, refpos, readpos));
+                jcts.push_back(Junction(seed, fw, false, tid, primary, refpos, readpos, readIdx));
                 refpos += oplen;
-                mJunctionReads[seed].push_back(Junction(fw, true, b->core.tid, readStart, refpos, readpos));
+                jcts.push_back(Junction(seed, fw, true, tid, primary, refpos, readpos, readIdx));
                 inserted = true;
             }else refpos += oplen;
         }else if(opint == BAM_CINS){
             readpos = (seqpos <= seqlen && !fw) ? seqlen - seqpos : seqpos;
             if(oplen > mOpt->filterOpt->mMinRefSep){
-                mJunctionReads[seed].push_back(Junction(fw, false, b->core.tid, readStart, refpos, readpos));
-                mJunctionReads[seed].push_back(Junction(fw, true, b->core.tid, readStart, refpos, readpos + oplen));
+                jcts.push_back(Junction(seed, fw, false, tid, primary, refpos, readpos, readIdx));
+                jcts.push_back(Junction(seed, fw, true, tid, primary, refpos, readpos + oplen, readIdx));
                 inserted = true;
             }
             seqpos += oplen;
@@ -42,7 +99,7 @@ bool JunctionMap::insertJunction(const bam1_t* b){
             seqpos += oplen;
             readpos = (lastSeqPos <= seqlen && !fw) ? seqlen - lastSeqPos : lastSeqPos;
             if(oplen > mOpt->filterOpt->minClipLen){
-                mJunctionReads[seed].push_back(Junction(fw, scleft, b->core.tid, readStart, refpos, readpos));
+                jcts.push_back(Junction(seed, fw, scleft, tid, primary, refpos, readpos, readIdx));
                 inserted = true;
             }
         }else if(opint == BAM_CREF_SKIP) refpos += oplen;
@@ -51,8 +108,44 @@ bool JunctionMap::insertJunction(const bam1_t* b){
 }
 
 void JunctionMap::sortJunctions(){
-    for(auto iter = mJunctionReads.begin(); iter != mJunctionReads.end(); ++iter){
-        std::sort(iter->second.begin(), iter->second.end());
+    // Partition records by the highest byte of hash, records of each partition keep insertion order
+    std::vector<size_t> partBeg(257, 0);
+    for(auto& jct: mJunctions) ++partBeg[(jct.mHash >> 56) + 1];
+    for(uint32_t i = 1; i < partBeg.size(); ++i) partBeg[i] += partBeg[i - 1];
+    std::vector<size_t> partFill(partBeg.begin(), partBeg.end() - 1);
+    std::vector<Junction> parted(mJunctions.size());
+    for(auto& jct: mJunctions) parted[partFill[jct.mHash >> 56]++] = jct;
+    mJunctions.swap(parted);
+    std::vector<Junction>().swap(parted);
+    // Sort partitions in parallel
+    ThreadPool::ThreadPool pool(std::max(1, mOpt->nthread));
+    std::vector<std::future<void>> rets;
+    for(uint32_t i = 0; i < 256; ++i){
+        if(partBeg[i + 1] - partBeg[i] > 1) rets.push_back(pool.enqueue(&JunctionMap::sortPartition, this, partBeg[i], partBeg[i + 1]));
     }
+    for(auto& e: rets) e.get();
     mSorted = true;
 }
+
+void JunctionMap::sortPartition(size_t beg, size_t end){
+    // Stable LSD radix sort on the lower 7 bytes of hash, bytes shared by all records are skipped
+    std::vector<Junction> tmp(end - beg);
+    Junction* src = &mJunctions[beg];
+    Junction* dst = &tmp[0];
+    size_t n = end - beg;
+    for(int shift = 0; shift < 56; shift += 8){
+        size_t cnt[257] = {0};
+        for(size_t i = 0; i < n; ++i) ++cnt[((src[i].mHash >> shift) & 0xff) + 1];
+        if(cnt[((src[0].mHash >> shift) & 0xff) + 1] == n) continue;
+        for(uint32_t k = 1; k < 257; ++k) cnt[k] += cnt[k - 1];
+        for(size_t i = 0; i < n; ++i) dst[cnt[(src[i].mHash >> shift) & 0xff]++] = src[i];
+        std::swap(src, dst);
+    }
+    if(src != &mJunctions[beg]) std::copy(src, src + n, &mJunctions[beg]);
+    // Order records of each read
+    for(size_t i = beg; i < end;){
+        size_t j = readEnd(i);
+        if(j - i > 1) std::sort(mJunctions.begin() + i, mJunctions.begin() + j);
+        i = j;
+    }
+}
@@ -1,38 +1,50 @@
 #ifndef JUNCTION_H
 #define JUNCTION_H
 
-#include <map>
 #include <string>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
 #include <cstdint>
+#include <algorithm>
 #include "svutil.h"
 #include "options.h"
 #include <htslib/sam.h>
 
-/** class to store junction alignment record */
+/** class to store junction alignment record, packed into 24 bytes */
 class Junction{
     public:
-        bool mForward;   ///< junction read is from forward strand if true (eg. !b->core.BAM_FREVERSE)
-        bool mSCleft;    ///< softclip is at leading left part of alignment if true
-        int32_t mRefidx; ///< junction record alignment reference tid (b->core.tid)
-        int32_t mRstart; ///< junction record alignment starting position on reference(b->core.pos)
-        int32_t mRefpos; ///< b->core.pos + reference length consumed before junction point
-        int32_t mSeqpos; ///< sequence length consumed before junction point(count from read 5'->3')
+        size_t mHash;         ///< hash value of read name
+        int32_t mRefpos;      ///< b->core.pos + reference length consumed before junction point
+        int32_t mSeqpos;      ///< sequence length consumed before junction point(count from read 5'->3')
+        int32_t mReadIdx;     ///< index of read captured in JunctionReadStore, -1 if not captured
+        uint16_t mRefidx;     ///< junction record alignment reference tid (b->core.tid)
+        uint8_t mForward : 1; ///< junction read is from forward strand if true (eg. !b->core.BAM_FREVERSE)
+        uint8_t mSCleft : 1;  ///< softclip is at leading left part of alignment if true
+        uint8_t mPrimary : 1; ///< junction record alignment is primary if true
     public:
+        /** Junction object constructor */
+        Junction(){}
+
         /** Junction object constructor 
+         * @param hash hash value of read name
          * @param forward junction read is from forward strand if true
          * @param scleft softclip is at leading left part of alignment if true
          * @param refidx junction record alignment reference tid (b->core.tid)
-         * @param rstart junction record alignment starting position on reference(b->core.pos)
+         * @param primary junction record alignment is primary if true
          * @param refpos b->core.pos + reference length consumed before junction point
          * @param seqpos sequence length consumed before junction point(count from read 5'->3')
+         * @param readIdx index of read captured in JunctionReadStore, -1 if not captured
          */
-        Junction(bool forward, bool scleft, int32_t refidx, int32_t rstart, int32_t refpos, int32_t seqpos){
+        Junction(size_t hash, bool forward, bool scleft, int32_t refidx, bool primary, int32_t refpos, int32_t seqpos, int32_t readIdx = -1){
+            mHash = hash;
             mForward = forward;
             mSCleft = scleft;
             mRefidx = refidx;
-            mRstart = rstart;
+            mPrimary = primary;
             mRefpos = refpos;
             mSeqpos = seqpos;
+            mReadIdx = readIdx;
         }
 
         /** operator to output an Junction object to ostream
@@ -42,17 +54,19 @@ class Junction{
          */
         inline friend std::ostream& operator<<(std::ostream& os, const Junction& jct){
             os << "==========================================\n";
-            os << std::boolalpha << "From Forward Strand: " << jct.mForward << "\n";
-            os << std::boolalpha << "Leading Soft Clip: " << jct.mSCleft << "\n";
+            os << "Read Hash: " << jct.mHash << "\n";
+            os << std::boolalpha << "From Forward Strand: " << (bool)jct.mForward << "\n";
+            os << std::boolalpha << "Leading Soft Clip: " << (bool)jct.mSCleft << "\n";
             os << "Reference ID: " << jct.mRefidx << "\n";
-            os << "Reference Mapping Pos: " << jct.mRstart << "\n";
+            os << std::boolalpha << "Primary Alignment: " << (bool)jct.mPrimary << "\n";
             os << "Clip position on Ref: " << jct.mRefpos << "\n";
             os << "Clip position on Read: " << jct.mSeqpos << "\n";
+            os << "Captured Read Index: " << jct.mReadIdx << "\n";
             os << "==========================================\n";
             return os;
         }
 
-        /** operator to compare two Junction object
+        /** operator to compare two Junction object of the same read
          * @return true if this Junction object is less than other
          */
         inline bool operator<(const Junction& other) const {
@@ -63,12 +77,124 @@ class Junction{
         }
 };
 
-/** Class to store Junction reads */
+/** class to store one alignment of an split read parsed from SA tag */
+struct SplitPart{
+    int32_t mTid;                ///< alignment reference tid
+    int32_t mPos;                ///< alignment starting position on reference
+    bool mForward;               ///< alignment is on forward strand if true
+    std::vector<uint32_t> mCigar; ///< alignment cigar in bam encoding
+};
+
+/** class to store alignment information of an junction read captured for assembly */
+struct JunctionRead{
+    uint64_t mOffset = 0; ///< offset of read sequence in JunctionReadStore::mSeqs
+    int32_t mTid = 0;     ///< read alignment reference tid (b->core.tid)
+    int32_t mPos = 0;     ///< read alignment starting position on reference (b->core.pos)
+    int32_t mLen = 0;     ///< read length (b->core.l_qseq)
+    uint8_t mQual = 0;    ///< read mapping quality (b->core.qual)
+    bool mReverse = false; ///< read is aligned on reverse strand if true (BAM_FREVERSE)
+};
+
+/** class to store sequences of junction reads compactly, sequences are kept 4-bit encoded as in bam */
+class JunctionReadStore{
+    public:
+        std::vector<JunctionRead> mReads; ///< reads captured
+        std::vector<uint8_t> mSeqs;       ///< 4-bit encoded sequences of all reads back to back
+
+    public:
+        /** JunctionReadStore constructor */
+        JunctionReadStore(){}
+
+        /** JunctionReadStore destructor */
+        ~JunctionReadStore(){}
+
+        /** get number of reads captured
+         * @return number of reads captured
+         */
+        inline size_t size() const {
+            return mReads.size();
+        }
+
+        /** capture an read
+         * @param b pointer to bam1_t struct
+         * @return index of read captured
+         */
+        inline int32_t add(const bam1_t* b){
+            JunctionRead jr;
+            jr.mOffset = mSeqs.size();
+            jr.mTid = b->core.tid;
+            jr.mPos = b->core.pos;
+            jr.mLen = b->core.l_qseq;
+            jr.mQual = b->core.qual;
+            jr.mReverse = b->core.flag & BAM_FREVERSE;
+            const uint8_t* seq = bam_get_seq(b);
+            mSeqs.insert(mSeqs.end(), seq, seq + (b->core.l_qseq + 1) / 2);
+            mReads.push_back(jr);
+            return mReads.size() - 1;
+        }
+
+        /** get sequence of an read captured
+         * @param idx index of read
+         * @return read sequence
+         */
+        inline std::string getSeq(int32_t idx) const {
+            const JunctionRead& jr = mReads[idx];
+            const uint8_t* data = &mSeqs[jr.mOffset];
+            std::string seq(jr.mLen, '\0');
+            for(int32_t i = 0; i < jr.mLen; ++i){
+                seq[i] = seq_nt16_str[bam_seqi(data, i)];
+            }
+            return seq;
+        }
+
+        /** drop reads not kept and move reads kept forward in their original order, memory of reads dropped is released
+         * @param keep keep[i] is true if read i is kept
+         * @param newIdx vector to store new index of each read, -1 if dropped
+         */
+        inline void compact(const std::vector<bool>& keep, std::vector<int32_t>& newIdx){
+            newIdx.assign(mReads.size(), -1);
+            size_t kept = 0;
+            uint64_t seqEnd = 0;
+            for(size_t i = 0; i < mReads.size(); ++i){
+                if(!keep[i]) continue;
+                JunctionRead jr = mReads[i];
+                uint64_t nbytes = (jr.mLen + 1) / 2;
+                std::copy(mSeqs.begin() + jr.mOffset, mSeqs.begin() + jr.mOffset + nbytes, mSeqs.begin() + seqEnd);
+                jr.mOffset = seqEnd;
+                seqEnd += nbytes;
+                mReads[kept] = jr;
+                newIdx[i] = kept++;
+            }
+            mReads.resize(kept);
+            mReads.shrink_to_fit();
+            mSeqs.resize(seqEnd);
+            mSeqs.shrink_to_fit();
+        }
+
+        /** move all reads of another JunctionReadStore to the end of this JunctionReadStore
+         * @param other pointer to JunctionReadStore to merge from
+         */
+        inline void merge(JunctionReadStore* other){
+            uint64_t seqBase = mSeqs.size();
+            mSeqs.insert(mSeqs.end(), other->mSeqs.begin(), other->mSeqs.end());
+            for(auto& jr: other->mReads){
+                mReads.push_back(jr);
+                mReads.back().mOffset += seqBase;
+            }
+            std::vector<uint8_t>().swap(other->mSeqs);
+            std::vector<JunctionRead>().swap(other->mReads);
+        }
+};
+
+/** Class to store Junction reads\n
+ * junctions of all reads are appended to one buffer, and grouped by read once sorted
+ */
 class JunctionMap{
     public:
-        Options* mOpt;                                          ///< pointer to Options
-        std::map<size_t, std::vector<Junction>> mJunctionReads; ///< <hash value of read name, <junction read parts>>
-        bool mSorted;                                           ///< Junction records in mJunctionReads are all sorted if true
+        Options* mOpt;                   ///< pointer to Options
+        std::vector<Junction> mJunctions; ///< junction read parts, ordered by hash value of read name and then by Junction::operator< once sorted
+        bool mSorted;                    ///< Junction records in mJunctions are all sorted if true
+        JunctionReadStore mReadStore;    ///< primary junction reads captured for assembly
 
     public:
         /** JunctionMap constructor
@@ -83,14 +209,95 @@ class JunctionMap{
         ~JunctionMap(){}
     public:
 
-        /** insert an read to JunctionMap if it is junction read
+        /** insert an read to JunctionMap if it is junction read, sequence of primary junction read is also captured\n
+         * reads not forming any SR are released once classified, see SRBamRecordSet::releaseReads
          * @param b pointer to bam1_t struct
          * @return true if b is an junction read and inserted successfuly
          */
         bool insertJunction(const bam1_t* b);
 
-        /** sort all Junction records in mJunctionReads */
+        /** get junctions of all split parts of an primary read whose other parts are parsed from SA tag,\n
+         * junctions are not inserted to JunctionMap, but sequence of the read is captured as in insertJunction
+         * @param b pointer to bam1_t struct of primary read
+         * @param parts other alignments of b parsed by parseSA
+         * @param jcts vector to store junctions of all parts, sorted
+         * @return true if any junction found
+         */
+        bool getSplitJunctions(const bam1_t* b, const std::vector<SplitPart>& parts, std::vector<Junction>& jcts);
+
+        /** parse other alignments of an read from its SA tag
+         * @param b pointer to bam1_t struct
+         * @param h pointer to bam header
+         * @param parts vector to store other alignments of b
+         * @return true if b has SA tag and all alignments of b are known, pass mapping quality filter and lie in valid regions
+         */
+        bool parseSA(const bam1_t* b, const bam_hdr_t* h, std::vector<SplitPart>& parts);
+
+        /** test whether an alignment would be scanned, i.e. it overlaps one of the valid regions to discovery SV
+         * @param tid alignment reference tid
+         * @param beg alignment starting position on reference
+         * @param end alignment ending position on reference(exclusive)
+         * @return true if [beg, end) overlaps an valid region on tid
+         */
+        inline bool inValidRegion(int32_t tid, int32_t beg, int32_t end) const {
+            if(tid < 0 || tid >= (int32_t)mOpt->validRegions.size()) return false;
+            for(auto& reg: mOpt->validRegions[tid]){
+                if(reg.first >= end) break;
+                if(beg < reg.second) return true;
+            }
+            return false;
+        }
+
+        /** append junctions of one alignment of an read
+         * @param seed hash value of read name
+         * @param fw alignment is on forward strand if true
+         * @param tid alignment reference tid
+         * @param pos alignment starting position on reference
+         * @param primary alignment is primary if true
+         * @param readIdx index of read captured in mReadStore, -1 if not captured
+         * @param cigar alignment cigar in bam encoding
+         * @param ncigar number of cigar operations
+         * @param jcts vector to append junctions to
+         * @return true if any junction appended
+         */
+        bool appendJunctions(size_t seed, bool fw, int32_t tid, int32_t pos, bool primary, int32_t readIdx, const uint32_t* cigar, uint32_t ncigar, std::vector<Junction>& jcts);
+
+        /** sort all Junction records in mJunctions by radix sort on hash value of read name\n
+         * records are partitioned by the highest byte of hash and partitions are sorted in parallel,\n
+         * records of the same read keep their insertion order before sorted by Junction::operator<
+         */
         void sortJunctions();
+
+        /** sort Junction records of one partition
+         * @param beg index of the first record of the partition in mJunctions
+         * @param end index past the last record of the partition in mJunctions
+         */
+        void sortPartition(size_t beg, size_t end);
+
+        /** get index range of Junction records of the read starting at an index, must be called after sorted
+         * @param beg index of the first record of an read in mJunctions
+         * @return index past the last record of the read
+         */
+        inline size_t readEnd(size_t beg) const {
+            size_t end = beg + 1;
+            while(end < mJunctions.size() && mJunctions[end].mHash == mJunctions[beg].mHash) ++end;
+            return end;
+        }
+
+        /** move all Junction records of another JunctionMap to the end of this JunctionMap
+         * @param other pointer to JunctionMap to merge from
+         */
+        inline void merge(JunctionMap* other){
+            int32_t readBase = mReadStore.size();
+            size_t first = mJunctions.size();
+            mJunctions.insert(mJunctions.end(), other->mJunctions.begin(), other->mJunctions.end());
+            for(size_t i = first; i < mJunctions.size(); ++i){
+                if(mJunctions[i].mReadIdx != -1) mJunctions[i].mReadIdx += readBase;
+            }
+            std::vector<Junction>().swap(other->mJunctions);
+            mReadStore.merge(&other->mReadStore);
+            mSorted = false;
+        }
         
         /** operator to output an JunctionMap object to ostream
          * @param os reference of ostream object
@@ -98,12 +305,8 @@ class JunctionMap{
          * @return reference of ostream object
          */
         inline friend std::ostream& operator<<(std::ostream& os, const JunctionMap& jctMap){
-            for(auto& e: jctMap.mJunctionReads){
-                os << "Read Hash: " << e.first << "\n";
-                int i = 1;
-                for(auto& f: e.second) os << "===== " << i++ << " =====\n" << f;
-                os << "\n";
-            }
+            int i = 1;
+            for(auto& f: jctMap.mJunctions) os << "===== " << i++ << " =====\n" << f;
             return os;
         }
 };
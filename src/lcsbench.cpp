@@ -0,0 +1,85 @@
+#include "msa.h"
+#include "bitlcs.h"
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+/** micro-benchmark of pairwise LCS used by MSA::distanceMatrix\n
+ * usage: lcsbench [reads per SV(default 60)] [read length(default 150)] [SVs(default 20)]\n
+ * reads of each SV are mutated copies of one random haplotype, all pairs of reads are computed by\n
+ * scalar MSA::lcs, 64-bit BitLCS and AVX2 BitLCS, results are checked equal
+ */
+int main(int argc, char** argv){
+    int k = argc > 1 ? std::atoi(argv[1]) : 60;
+    int len = argc > 2 ? std::atoi(argv[2]) : 150;
+    int nsv = argc > 3 ? std::atoi(argv[3]) : 20;
+    std::mt19937 gen(7);
+    const char bases[4] = {'A', 'C', 'G', 'T'};
+    std::vector<std::vector<std::string>> reads(nsv);
+    for(int s = 0; s < nsv; ++s){
+        std::string hap(len + len / 2, 'A');
+        for(auto& c: hap) c = bases[gen() & 3];
+        for(int r = 0; r < k; ++r){
+            // Random offset, 2% substitutions and a few indels
+            std::string read = hap.substr(gen() % (len / 2), len);
+            for(auto& c: read) if(gen() % 50 == 0) c = bases[gen() & 3];
+            if(gen() % 4 == 0) read.erase(gen() % read.size(), 1);
+            if(gen() % 4 == 0) read.insert(gen() % read.size(), 1, bases[gen() & 3]);
+            reads[s].push_back(read);
+        }
+    }
+    size_t pairs = (size_t)nsv * k * (k - 1) / 2;
+    std::vector<int> scalar, bit, simd;
+    scalar.reserve(pairs);
+    bit.reserve(pairs);
+    simd.reserve(pairs);
+    // Scalar DP
+    auto t0 = std::chrono::steady_clock::now();
+    for(auto& rs: reads){
+        for(int i = 0; i < k; ++i){
+            for(int j = i + 1; j < k; ++j) scalar.push_back(MSA::lcs(rs[i], rs[j]));
+        }
+    }
+    // Bit-parallel, one pair at a time
+    auto t1 = std::chrono::steady_clock::now();
+    for(auto& rs: reads){
+        for(int i = 0; i < k; ++i){
+            BitLCS bl(rs[i].data(), rs[i].size());
+            for(int j = i + 1; j < k; ++j) bit.push_back(bl.lcs(rs[j].data(), rs[j].size()));
+        }
+    }
+    // Bit-parallel, 4 pairs at a time
+    auto t2 = std::chrono::steady_clock::now();
+    const char* t[4];
+    int n[4];
+    int ret[4];
+    for(auto& rs: reads){
+        for(int i = 0; i < k; ++i){
+            BitLCS bl(rs[i].data(), rs[i].size());
+            int j = i + 1;
+            for(; j + 4 <= k; j += 4){
+                for(int l = 0; l < 4; ++l){
+                    t[l] = rs[j + l].data();
+                    n[l] = rs[j + l].size();
+                }
+                bl.lcs4(t, n, ret);
+                simd.insert(simd.end(), ret, ret + 4);
+            }
+            for(; j < k; ++j) simd.push_back(bl.lcs(rs[j].data(), rs[j].size()));
+        }
+    }
+    auto t3 = std::chrono::steady_clock::now();
+    double ts = std::chrono::duration<double>(t1 - t0).count();
+    double tb = std::chrono::duration<double>(t2 - t1).count();
+    double tv = std::chrono::duration<double>(t3 - t2).count();
+    bool same = scalar == bit && scalar == simd;
+    printf("pairs: %zu, read length: %d, AVX2: %s\n", pairs, len, BitLCS::avx2() ? "yes" : "no");
+    printf("scalar DP:       %.4fs\n", ts);
+    printf("BitLCS 64-bit:   %.4fs (%.1fx)\n", tb, ts / tb);
+    printf("BitLCS 4 pairs:  %.4fs (%.1fx)\n", tv, ts / tv);
+    printf("results %s\n", same ? "identical" : "DIFFER");
+    return same ? 0 : 1;
+}
@@ -20,7 +20,16 @@ int main(int argc, char** argv){
     app.add_option("-o,--bcfout", opt->bcfOut, "output bcf file", true)->required(false)->group("General");
     app.add_option("-t,--tsvout", opt->tsvOut, "output tsv file", true)->required(false)->group("General");
     app.add_option("-s,--svtype", opt->svtypes, "SV types to discover,0:INV,1:DEL,2:DUP,3:INS,4:BND")->check(CLI::Range(0, 4))->group("General");
-    app.add_option("-n,--nthread", opt->nthread, "number of threads used to process bam", true)->check(CLI::Range(1, 20))->group("General");
+    app.add_option("-n,--nthread", opt->nthread, "number of threads used to process bam", true)->check(CLI::Range(1, 128))->group("General");
+    app.add_option("--tile", opt->tileSize, "genomic tile size processed by one thread each time", true)->check(CLI::Range(100000, 1000000000))->group("General");
+    app.add_flag("--onepass", opt->onePass, "decode bam once and buffer reads needed by genotyping in memory")->group("General");
+    app.add_flag("--streamsr", opt->streamSR, "classify split reads with SA tag while scanning instead of keeping their junctions")->group("General");
+    app.add_option("--maxdensity", opt->filterOpt->mMaxEvidenceDensity, "maximum SR/DP records in one clustering window, records of denser regions are subsampled", true)->check(CLI::Range(10, 100000000))->group("General");
+    app.add_flag("--libfull", opt->libFullScan, "with --libsample, visit all positions without stopping once estimates converged")->group("Library");
+    app.add_flag("--libsample", opt->libSample, "estimate library information from reads sampled across contigs by bam index, stop once estimates converged")->group("Library");
+    app.add_option("--libspots", opt->libSampleSpots, "maximum number of positions sampled across contigs", true)->check(CLI::Range(1, 1 << 20))->group("Library");
+    app.add_option("--libreads", opt->libSampleReads, "maximum number of reads sampled at each position", true)->check(CLI::Range(1, 1000000))->group("Library");
+    app.add_flag("--relib", opt->libRecompute, "estimate library information even if library cache file <bam>.sver.lib matches")->group("Library");
     CLI_PARSE(app, argc, argv);
     // validate arguments
     util::loginfo("Command line arguments parsed");
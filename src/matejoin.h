@@ -0,0 +1,231 @@
+#ifndef MATEJOIN_H
+#define MATEJOIN_H
+
+#include <queue>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+/** class to store hash of reads mapped at the same position, usually only a few */
+class SamePosReads{
+    public:
+        int32_t mPos = -1;           ///< mapping position of reads stored
+        std::vector<size_t> mHashes; ///< hash of reads mapped at mPos
+
+    public:
+        /** SamePosReads constructor */
+        SamePosReads(){}
+
+        /** SamePosReads destructor */
+        ~SamePosReads(){}
+
+        /** move to a new mapping position, reads stored are dropped if pos is beyond mPos
+         * @param pos mapping position of current read
+         */
+        inline void advance(int32_t pos){
+            if(pos > mPos){
+                mHashes.clear();
+                mPos = pos;
+            }
+        }
+
+        /** add one read mapped at mPos
+         * @param hv hash of read
+         */
+        inline void add(size_t hv){
+            mHashes.push_back(hv);
+        }
+
+        /** test whether an read is stored
+         * @param hv hash of read
+         * @return true if hv is stored
+         */
+        inline bool contains(size_t hv) const {
+            return std::find(mHashes.begin(), mHashes.end(), hv) != mHashes.end();
+        }
+};
+
+/** first read of an pair waiting for its mate */
+template<typename T>
+struct MateEntry{
+    size_t mHash; ///< hash of the pair
+    int64_t mDue; ///< locus of mate
+    T mValue;     ///< value stored for the pair
+
+    /** MateEntry constructor
+     * @param hv hash of the pair
+     * @param due locus of mate
+     * @param v value stored for the pair
+     */
+    MateEntry(size_t hv, int64_t due, const T& v) : mHash(hv), mDue(due), mValue(v) {}
+};
+
+/** class to join the two reads of an pair in coordinate sorted order\n
+ * the first read is stored by pair hash in an open addressing table with linear probing\n
+ * and evicted once the scan passes the expected position of its mate, so only pairs\n
+ * spanning the current position are kept in memory
+ */
+template<typename T>
+class MateJoinTable{
+    public:
+        /** one slot of table */
+        struct Slot{
+            size_t mHash;  ///< hash of the pair
+            int64_t mDue;  ///< locus of mate, slot is evicted once scan passes it
+            T mValue;      ///< value stored for the pair
+            bool mFull;    ///< slot is occupied
+        };
+
+        typedef std::pair<int64_t, size_t> DueItem; ///< <due locus, hash>
+
+        std::vector<Slot> mSlots;   ///< slots, size is always power of 2
+        size_t mSize;               ///< occupied slots
+        std::priority_queue<DueItem, std::vector<DueItem>, std::greater<DueItem>> mDues; ///< entries ordered by due locus
+
+    public:
+        /** MateJoinTable constructor
+         * @param capacity initial slots, rounded up to power of 2
+         */
+        MateJoinTable(size_t capacity = 1024){
+            size_t n = 16;
+            while(n < capacity) n <<= 1;
+            mSlots.resize(n);
+            for(auto& s: mSlots) s.mFull = false;
+            mSize = 0;
+        }
+
+        /** MateJoinTable destructor */
+        ~MateJoinTable(){}
+
+        /** combine reference id and position into one sortable locus
+         * @param tid reference id
+         * @param pos position on reference
+         * @return locus of (tid, pos)
+         */
+        inline static int64_t locus(int32_t tid, int32_t pos){
+            return ((int64_t)tid << 32) | (uint32_t)pos;
+        }
+
+        /** get number of pairs stored
+         * @return pairs stored
+         */
+        inline size_t size() const {
+            return mSize;
+        }
+
+        /** insert or overwrite value of an pair
+         * @param hv hash of the pair
+         * @param due locus of mate
+         * @param v value of the pair
+         */
+        inline void insert(size_t hv, int64_t due, const T& v){
+            if(2 * (mSize + 1) > mSlots.size()) rehash(mSlots.size() << 1);
+            size_t i = home(hv);
+            while(mSlots[i].mFull && mSlots[i].mHash != hv) i = (i + 1) & (mSlots.size() - 1);
+            if(!mSlots[i].mFull){
+                mSlots[i].mFull = true;
+                mSlots[i].mHash = hv;
+                ++mSize;
+            }
+            mSlots[i].mDue = due;
+            mSlots[i].mValue = v;
+            mDues.push(std::make_pair(due, hv));
+        }
+
+        /** insert or overwrite value of an pair
+         * @param e first read of the pair
+         */
+        inline void insert(const MateEntry<T>& e){
+            insert(e.mHash, e.mDue, e.mValue);
+        }
+
+        /** find value of an pair
+         * @param hv hash of the pair
+         * @return pointer to value of the pair, NULL if not found
+         */
+        inline T* find(size_t hv){
+            size_t i = home(hv);
+            while(mSlots[i].mFull){
+                if(mSlots[i].mHash == hv) return &mSlots[i].mValue;
+                i = (i + 1) & (mSlots.size() - 1);
+            }
+            return NULL;
+        }
+
+        /** remove an pair
+         * @param hv hash of the pair
+         */
+        inline void erase(size_t hv){
+            size_t mask = mSlots.size() - 1;
+            size_t i = home(hv);
+            while(mSlots[i].mFull && mSlots[i].mHash != hv) i = (i + 1) & mask;
+            if(!mSlots[i].mFull) return;
+            // Shift following slots of the same probe chain backward instead of leaving tombstones
+            size_t j = i;
+            while(true){
+                j = (j + 1) & mask;
+                if(!mSlots[j].mFull) break;
+                size_t k = home(mSlots[j].mHash);
+                if((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))){
+                    mSlots[i] = mSlots[j];
+                    i = j;
+                }
+            }
+            mSlots[i].mFull = false;
+            --mSize;
+        }
+
+        /** evict pairs whose mate locus is before an locus
+         * @param cur locus the scan reached
+         */
+        inline void evict(int64_t cur){
+            while(!mDues.empty() && mDues.top().first < cur){
+                size_t hv = mDues.top().second;
+                int64_t due = mDues.top().first;
+                mDues.pop();
+                size_t i = home(hv);
+                while(mSlots[i].mFull && mSlots[i].mHash != hv) i = (i + 1) & (mSlots.size() - 1);
+                if(mSlots[i].mFull && mSlots[i].mDue == due) erase(hv); // skip stale items of overwritten pairs
+            }
+            if(mSlots.size() > 1024 && 16 * mSize < mSlots.size()){// release slots after an dense region
+                size_t n = 1024;
+                while(n < 4 * mSize) n <<= 1;
+                rehash(n);
+            }
+        }
+
+        /** remove all pairs */
+        inline void clear(){
+            for(auto& s: mSlots) s.mFull = false;
+            mSize = 0;
+            std::priority_queue<DueItem, std::vector<DueItem>, std::greater<DueItem>>().swap(mDues);
+        }
+
+    private:
+        /** get home slot of an hash
+         * @param hv hash of the pair
+         * @return index of home slot
+         */
+        inline size_t home(size_t hv) const {
+            return (hv * 0x9e3779b97f4a7c15ULL) >> 17 & (mSlots.size() - 1);
+        }
+
+        /** resize slots and reinsert all pairs
+         * @param n new slots, must be power of 2
+         */
+        inline void rehash(size_t n){
+            std::vector<Slot> old(n);
+            for(auto& s: old) s.mFull = false;
+            old.swap(mSlots);
+            for(auto& s: old){
+                if(!s.mFull) continue;
+                size_t i = home(s.mHash);
+                while(mSlots[i].mFull) i = (i + 1) & (mSlots.size() - 1);
+                mSlots[i] = s;
+            }
+        }
+};
+
+#endif
@@ -1,8 +1,6 @@
 #include "msa.h"
 
-int MSA::lcs(const std::string& s1, const std::string& s2){
-    int m = s1.size();
-    int n = s2.size();
+int MSA::lcs(const char* s1, int m, const char* s2, int n){
     int preDiag = 0;
     int prePreDiag = 0;
     std::vector<int> s(n + 1, 0);
@@ -15,7 +13,7 @@ int MSA::lcs(const std::string& s1, const std::string& s2){
             }else{
                 prePreDiag = preDiag;
                 preDiag = s[j];
-                if(s1[i - 1] == s2[i - 1]){
+                if(s1[i - 1] == s2[j - 1]){
                     s[j] = prePreDiag + 1;
                 }else{
                     s[j] = (s[j] > s[j-1] ? s[j] : s[j-1]);
@@ -27,13 +25,25 @@ int MSA::lcs(const std::string& s1, const std::string& s2){
 }
 
 void MSA::distanceMatrix(Matrix2D<int>* d){
-    auto iter1 = mSeqs->cbegin();
-    auto iter2 = iter1;
-    for(int i = 0; iter1 != mSeqs->cend(); ++iter1, ++i){
-        iter2 = iter1;
-        ++iter2;
-        for(int j = i + 1; iter2 != mSeqs->cend(); ++iter2, ++j){
-            d->set(i, j) = lcs(*iter1, *iter2) * 100 / (std::min(iter1->length(), iter2->length()));
+    bool avx2 = BitLCS::avx2();
+    const char* t[4];
+    int n[4];
+    int ret[4];
+    for(int i = 0; i < mSeqs->size(); ++i){
+        BitLCS bl(mSeqs->seq(i), mSeqs->length(i));
+        int j = i + 1;
+        for(; avx2 && j + 4 <= mSeqs->size(); j += 4){
+            for(int l = 0; l < 4; ++l){
+                t[l] = mSeqs->seq(j + l);
+                n[l] = mSeqs->length(j + l);
+            }
+            bl.lcs4(t, n, ret);
+            for(int l = 0; l < 4; ++l){
+                d->set(i, j + l) = ret[l] * 100 / (std::min(mSeqs->length(i), n[l]));
+            }
+        }
+        for(; j < mSeqs->size(); ++j){
+            d->set(i, j) = bl.lcs(mSeqs->seq(j), mSeqs->length(j)) * 100 / (std::min(mSeqs->length(i), mSeqs->length(j)));
         }
     }
 }
@@ -94,22 +104,20 @@ int MSA::upgma(Matrix2D<int>* d, Matrix2D<int>* p, int num){
     return nn > 0 ? (nn - 1) : 0;
 }
 
-void MSA::palign(const Matrix2D<int>* p, int root, Matrix2D<char>* aln){
+void MSA::palign(const Matrix2D<int>* p, int root, Matrix2D<char>* aln, std::vector<int32_t>& weights){
     if(p->get(root, 1) == -1 && p->get(root, 2) == -1){
-        auto iter = mSeqs->begin();
-        if(root){
-            std::advance(iter, root);
-        }
-        aln->resize(1, iter->size());
-        int ind = 0;
-        for(auto siter = iter->begin(); siter != iter->end(); ++siter){
-            aln->set(0, ind++) = *siter;
+        const char* seq = mSeqs->seq(root);
+        aln->resize(1, mSeqs->length(root));
+        for(int ind = 0; ind < mSeqs->length(root); ++ind){
+            aln->set(0, ind) = seq[ind];
         }
+        weights.push_back(mSeqs->count(root));
     }else{
+        // Rows of aln1 are placed before rows of aln2 in aln, so are their weights
         Matrix2D<char>* aln1 = new Matrix2D<char>();
-        palign(p, p->get(root, 1), aln1);
+        palign(p, p->get(root, 1), aln1, weights);
         Matrix2D<char>* aln2 = new Matrix2D<char>();
-        palign(p, p->get(root, 2), aln2);
+        palign(p, p->get(root, 2), aln2, weights);
         Aligner* aligner = new Aligner(aln1, aln2, mAlignConfig);
         aligner->gotoh(aln);
         delete aln1;
@@ -118,7 +126,7 @@ void MSA::palign(const Matrix2D<int>* p, int root, Matrix2D<char>* aln){
     }
 }
 
-void MSA::consensus(Matrix2D<char>* aln, std::string& cs){
+void MSA::consensus(Matrix2D<char>* aln, const std::vector<int32_t>& weights, std::string& cs){
     // Calculate coverage of non-gaps
     Matrix2D<bool>* fl = new Matrix2D<bool>(aln->nrow(), aln->ncol());
     std::vector<int> cov(aln->ncol(), 0);
@@ -135,7 +143,7 @@ void MSA::consensus(Matrix2D<char>* aln, std::string& cs){
             }
         }
         for(int j = beg; j <= end; ++j){
-            ++cov[j];
+            cov[j] += weights[i];
             fl->set(i, j) = true;
         }
     }
@@ -150,16 +158,16 @@ void MSA::consensus(Matrix2D<char>* aln, std::string& cs){
                 if(fl->get(i, j)){
                     switch(aln->get(i, j)){
                         case 'A': case 'a':
-                            ++countBase[0];
+                            countBase[0] += weights[i];
                             break;
                         case 'C': case 'c':
-                            ++countBase[1];
+                            countBase[1] += weights[i];
                             break;
                         case 'G': case 'g':
-                            ++countBase[2];
+                            countBase[2] += weights[i];
                             break;
                         case 'T': case 't':
-                            ++countBase[3];
+                            countBase[3] += weights[i];
                             break;
                         default:
                             break;
@@ -205,13 +213,14 @@ int MSA::msa(std::string& cs){
     int root = upgma(d, p, num);
     // Progressive Alignment
     Matrix2D<char>* aln = new Matrix2D<char>();
-    palign(p, root, aln);
+    std::vector<int32_t> weights;
+    palign(p, root, aln, weights);
     // Consensus calling
-    consensus(aln, cs);
+    consensus(aln, weights, cs);
     // Cleanup Resources
     delete d;
     delete p;
-    int support = aln->nrow();
+    int support = mSeqs->total();
     delete aln;
     // Return split-read support;
     return support;
@@ -1,7 +1,9 @@
 #ifndef MSA_H
 #define MSA_H
 
-#include <set>
+#include <vector>
+#include "bitlcs.h"
+#include "seqset.h"
 #include "aligner.h"
 #include "matrix2d.h"
 #include "aligncfg.h"
@@ -9,7 +11,7 @@
 /** class to do multiple sequence alignment */
 class MSA{
     public:
-        std::multiset<std::string>* mSeqs = NULL; ///< sequences to do msa
+        SeqSet* mSeqs = NULL;                     ///< unique sequences to do msa, weighted by multiplicity
         AlignConfig* mAlignConfig = NULL;         ///< alignment strategy used
         bool mDefaultConfigCreated = false;       ///< default mAlignConfig constructed if true
         int32_t mMinCovForCS = 3;                 ///< minimum coverage needed for a position in msa result to be included in consensus sequence
@@ -17,12 +19,12 @@ class MSA{
 
     public:
         /** MSA constructor
-         * @param seqs pointer to a set of sequences to do msa
+         * @param seqs pointer to a set of unique sequences to do msa, finish() called
          * @param minCovForCS minimum coverage needed for a position in msa result to be included in consensus sequence
          * @param minBaseRatioForCS minimum base ratio needed for a position in msa result to be included in consensus sequence
          * @param alignCfg alignment strategy used
          */
-        MSA(std::multiset<std::string>* seqs, int32_t minCovForCS = 3, float minBaseRatioForCS = 0.5, AlignConfig* alignCfg = NULL){
+        MSA(SeqSet* seqs, int32_t minCovForCS = 3, float minBaseRatioForCS = 0.5, AlignConfig* alignCfg = NULL){
             mSeqs = seqs;
             if(alignCfg) mAlignConfig = alignCfg;
             else{
@@ -46,11 +48,23 @@ class MSA{
          * @param s2 sequence
          * @return longest common sequence length of s1 and s2
          */
-        static int lcs(const std::string& s1, const std::string& s2);
+        static int lcs(const std::string& s1, const std::string& s2){
+            return lcs(s1.data(), s1.size(), s2.data(), s2.size());
+        }
+
+        /** get longest common sequence of two sequence s1 and s2(gaps allowed) by scalar DP, BitLCS gives the same result faster
+         * @param s1 bases of sequence
+         * @param m length of s1
+         * @param s2 bases of sequence
+         * @param n length of s2
+         * @return longest common sequence length of s1 and s2
+         */
+        static int lcs(const char* s1, int m, const char* s2, int n);
         
         /** construct distance matrix of mSeqs, d is square matrix with (2 * mSeqs.size() + 1) rows\n
          * initially d[i, j] = 0 for i >= j, d[i, j] = -1 otherwise\n
          * in distanceMatrix function d[i, j] = 100 * lcs(seqi, seqj)/ min(seqi.size(), seqj.size()) for i < j( i < mSeqs.size(), j < mSeqs.size())\n
+         * lcs is computed by BitLCS with seqi as pattern, 4 seqj at once if AVX2 supported\n
          * @param d matrix to store pair-wise distance of mSeqs
          */
         void distanceMatrix(Matrix2D<int>* d);
@@ -102,14 +116,17 @@ class MSA{
          * @param p phylogenetic matrix used in UPGMA
          * @param root root of phylogenetic matrix p, just the last column number in p to store the final clustered seq distances
          * @param aln matrix to store msa result
+         * @param weights vector to append multiplicity of sequence in each row of aln
          */
-        void palign(const Matrix2D<int>* p, int root, Matrix2D<char>* aln);
+        void palign(const Matrix2D<int>* p, int root, Matrix2D<char>* aln, std::vector<int32_t>& weights);
 
         /** get consensus string from msa result that satisfy coverage and majority base rate limits\n
+         * each row counts as many times as its sequence added in coverage and base voting
          * @param aln matrix to store msa alignment result
+         * @param weights multiplicity of sequence in each row of aln
          * @param cs consensus string got from msa alignment result
          */
-        void consensus(Matrix2D<char>* aln, std::string& cs);
+        void consensus(Matrix2D<char>* aln, const std::vector<int32_t>& weights, std::string& cs);
         
         /** do multiple seqeuence alignment of mSeqs\n
          * @paramm cs consensus sequence got from msa
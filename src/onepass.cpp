@@ -0,0 +1,270 @@
+#include "onepass.h"
+
+void BamBuffer::push(const bam1_t* b){
+    uint32_t dlen = b->core.l_qname + 4 * b->core.n_cigar + (b->core.l_qseq + 1) / 2 + b->core.l_qseq;
+    const uint8_t* hpptr = bam_aux_get(b, "HP");
+    uint32_t len = sizeof(bam1_core_t) + dlen + (hpptr ? 7 : 0);
+    size_t offset = mData.size();
+    mData.resize(offset + sizeof(uint32_t) + len);
+    uint8_t* p = &mData[offset];
+    memcpy(p, &len, sizeof(uint32_t));
+    p += sizeof(uint32_t);
+    memcpy(p, &b->core, sizeof(bam1_core_t));
+    p += sizeof(bam1_core_t);
+    memcpy(p, b->data, dlen);
+    p += dlen;
+    if(hpptr){// HP tag is stored as an int32 aux field
+        int32_t hpv = bam_aux2i(hpptr);
+        p[0] = 'H';
+        p[1] = 'P';
+        p[2] = 'i';
+        memcpy(p + 3, &hpv, sizeof(int32_t));
+    }
+    ++mCount;
+}
+
+void BamBuffer::popFront(){
+    uint32_t len = 0;
+    memcpy(&len, &mData[mHead], sizeof(uint32_t));
+    mHead += sizeof(uint32_t) + len;
+    --mCount;
+    if(mHead >= mData.size()){
+        mData.clear();
+        mHead = 0;
+    }else if(mHead > (1 << 20) && mHead > mData.size() / 2){// Reclaim space of popped records
+        mData.erase(mData.begin(), mData.begin() + mHead);
+        mHead = 0;
+    }
+}
+
+void BamBuffer::moveTo(BamBuffer* other){
+    other->mData.insert(other->mData.end(), mData.begin() + mHead, mData.end());
+    other->mCount += mCount;
+    mData.clear();
+    mHead = 0;
+    mCount = 0;
+}
+
+bool BamBuffer::next(bam1_t* b, size_t& offset) const {
+    if(offset < mHead) offset = mHead;
+    if(offset >= mData.size()) return false;
+    uint32_t len = 0;
+    memcpy(&len, &mData[offset], sizeof(uint32_t));
+    const uint8_t* p = &mData[offset + sizeof(uint32_t)];
+    memcpy(&b->core, p, sizeof(bam1_core_t));
+    uint32_t dlen = len - sizeof(bam1_core_t);
+    if(b->m_data < dlen){
+        b->data = (uint8_t*)realloc(b->data, dlen);
+        b->m_data = dlen;
+    }
+    memcpy(b->data, p + sizeof(bam1_core_t), dlen);
+    b->l_data = dlen;
+    offset += sizeof(uint32_t) + len;
+    return true;
+}
+
+void FragmentTrack::seal(){
+    std::sort(mPos.begin(), mPos.end());
+    int32_t lastPos = 0;
+    for(auto& pos: mPos){
+        uint32_t delta = pos - lastPos;
+        while(delta >= 0x80){
+            mPacked.push_back((delta & 0x7f) | 0x80);
+            delta >>= 7;
+        }
+        mPacked.push_back(delta);
+        lastPos = pos;
+    }
+    mCount = mPos.size();
+    mPacked.shrink_to_fit();
+    std::vector<int32_t>().swap(mPos);
+}
+
+void FragmentTrack::unpack(std::vector<int32_t>& pos) const {
+    pos.clear();
+    pos.reserve(mCount);
+    int32_t lastPos = 0;
+    for(size_t i = 0; i < mPacked.size();){
+        uint32_t delta = 0;
+        int shift = 0;
+        while(mPacked[i] & 0x80){
+            delta |= (uint32_t)(mPacked[i++] & 0x7f) << shift;
+            shift += 7;
+        }
+        delta |= (uint32_t)mPacked[i++] << shift;
+        lastPos += delta;
+        pos.push_back(lastPos);
+    }
+}
+
+TileCollector::TileCollector(Options* opt, const GenomeTile& tile){
+    mOpt = opt;
+    mTile = tile;
+    mCovReads = new BamBuffer();
+    mLookback = new BamBuffer();
+    mTrack = new FragmentTrack(tile.mTid);
+    mReadSep = opt->filterOpt->mMaxReadSep;
+    mPairTol = opt->libInfo->mVarisize + opt->libInfo->mReadLen;
+    mFlank = opt->libInfo->mVarisize + opt->libInfo->mMaxNormalISize + 2 * opt->libInfo->mReadLen;
+    mContext = mFlank + mPairTol;
+    mHotEnd = -1;
+    mRecentDPs.resize(9);
+}
+
+void TileCollector::collect(bam1_t* b){
+    const uint16_t BAM_SRSKIP_MASK = (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY);
+    const uint16_t COV_STAT_SKIP_MASK = (BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP | BAM_FMUNMAP);
+    int32_t pos = b->core.pos;
+    bool owned = mTile.owns(b) && pos < mTile.mEnd;
+    // Drop reads and evidences which can not be used by any later evidence
+    while(!mLookback->empty() && mLookback->frontPos() < pos - mContext) mLookback->popFront();
+    while(!mRecentJcts.empty() && *mRecentJcts.begin() < pos - mReadSep) mRecentJcts.erase(mRecentJcts.begin());
+    for(auto& q: mRecentDPs){
+        while(!q.empty() && q.front().first < pos - mPairTol) q.pop_front();
+    }
+    // Two close junctions or two DPs with close mates make an dense evidence
+    if(!(b->core.flag & BAM_SRSKIP_MASK) && b->core.qual >= mOpt->filterOpt->minMapQual && b->core.tid >= 0){
+        getJunctions(b, mJcts);
+        for(auto& p: mJcts){
+            auto itj = mRecentJcts.lower_bound(p - mReadSep);
+            if(itj != mRecentJcts.end() && *itj <= p + mReadSep) anchor(std::max(p, *itj));
+        }
+        mRecentJcts.insert(mJcts.begin(), mJcts.end());
+        int32_t svt = getDPSVType(b);
+        if(svt != -1){
+            for(auto& e: mRecentDPs[svt]){
+                if(e.second.first != b->core.mtid || std::abs(e.second.second - b->core.mpos) > mPairTol) continue;
+                if(e.first == b->core.mpos && e.second.second == pos) continue; // mate of this read
+                anchor(pos);
+                break;
+            }
+            mRecentDPs[svt].push_back(std::make_pair(pos, std::make_pair(b->core.mtid, b->core.mpos)));
+        }
+    }
+    // Keep reads for genotyping
+    if(!owned) return;
+    if(b->core.flag & COV_STAT_SKIP_MASK) return;
+    if(b->core.qual < mOpt->filterOpt->mMinGenoQual) return;
+    if(pos <= mHotEnd) mCovReads->push(b);
+    else mLookback->push(b);
+    addFragment(b);
+}
+
+void TileCollector::finish(){
+    mLookback->clear();
+    mCovReads->mData.shrink_to_fit();
+    mTrack->seal();
+    mRecentJcts.clear();
+    mRecentDPs.clear();
+    mQualities.clear();
+}
+
+void TileCollector::anchor(int32_t hi){
+    mLookback->moveTo(mCovReads);
+    mHotEnd = std::max(mHotEnd, hi + mFlank);
+}
+
+int32_t TileCollector::getDPSVType(const bam1_t* b){
+    const uint16_t BAM_DPSKIP_MASK = (BAM_FSUPPLEMENTARY | BAM_FMUNMAP);
+    if(mOpt->libInfo->mMedian == 0) return -1; // SE library
+    if(b->core.flag & BAM_DPSKIP_MASK) return -1;
+    if(mOpt->validRegions[b->core.mtid].empty()) return -1;
+    if(b->core.tid != b->core.mtid && b->core.qual < mOpt->filterOpt->mMinTraQual) return -1;
+    int32_t svt = DPBamRecord::getSVType(b, mOpt);
+    if(svt == -1) return -1;
+    if(mOpt->SVTSet.find(svt) == mOpt->SVTSet.end()) return -1;
+    return svt;
+}
+
+void TileCollector::getJunctions(const bam1_t* b, std::vector<int32_t>& jcts){
+    jcts.clear();
+    int32_t refpos = b->core.pos;
+    const uint32_t* cigar = bam_get_cigar(b);
+    for(uint32_t i = 0; i < b->core.n_cigar; ++i){
+        int opint = bam_cigar_op(cigar[i]);
+        int oplen = bam_cigar_oplen(cigar[i]);
+        if(opint == BAM_CMATCH || opint == BAM_CEQUAL || opint == BAM_CDIFF || opint == BAM_CREF_SKIP){
+            refpos += oplen;
+        }else if(opint == BAM_CDEL){
+            if(oplen > mOpt->filterOpt->mMinRefSep){
+                jcts.push_back(refpos);
+                jcts.push_back(refpos + oplen);
+            }
+            refpos += oplen;
+        }else if(opint == BAM_CINS){
+            if(oplen > mOpt->filterOpt->mMinRefSep) jcts.push_back(refpos);
+        }else if(opint == BAM_CSOFT_CLIP || opint == BAM_CHARD_CLIP){
+            if(oplen > mOpt->filterOpt->minClipLen) jcts.push_back(refpos);
+        }
+    }
+}
+
+void TileCollector::addFragment(bam1_t* b){
+    if(!(b->core.flag & BAM_FPAIRED) || b->core.tid != b->core.mtid) return;
+    mQualities.evict(MateJoinTable<uint8_t>::locus(b->core.tid, b->core.pos));
+    mLastAlignedPosReads.advance(b->core.pos);// clear records aligned at the same position
+    size_t seed = svutil::hashString(bam_get_qname(b));
+    // Same rule as Stats::firstInPair
+    if(b->core.pos < b->core.mpos || (b->core.pos == b->core.mpos && !mLastAlignedPosReads.contains(seed))){
+        mLastAlignedPosReads.add(seed);
+        size_t hv = svutil::hashPairCurr(b);
+        if(mTile.mateAfter(b)) mMates[hv] = b->core.qual;
+        else mQualities.insert(hv, MateJoinTable<uint8_t>::locus(b->core.mtid, b->core.mpos), b->core.qual);
+    }else{
+        size_t hv = svutil::hashPairMate(b);
+        int32_t midPos = b->core.pos + bam_cigar2rlen(b->core.n_cigar, bam_get_cigar(b)) / 2;
+        if(mTile.mateBefore(b)){// Mate will be joined after all tiles finished
+            mPendingMids.push_back(PendingFragment(hv, b->core.tid, midPos, b->core.qual));
+            return;
+        }
+        uint8_t* itq = mQualities.find(hv);
+        if(!itq) return;
+        uint8_t pairQual = std::min(*itq, b->core.qual);
+        mQualities.erase(hv);
+        if(pairQual >= mOpt->filterOpt->mMinGenoQual) mTrack->add(midPos);
+    }
+}
+
+void OnePassStore::merge(TileCollector* tc){
+    uint32_t i = tc->mTile.mIdx;
+    mCovReads[i] = tc->mCovReads;
+    tc->mCovReads = NULL;
+    mTracks.push_back(tc->mTrack);
+    tc->mTrack = NULL;
+    for(auto& m: tc->mMates) mMates[m.first] = m.second;
+    mPendingMids.insert(mPendingMids.end(), tc->mPendingMids.begin(), tc->mPendingMids.end());
+}
+
+void OnePassStore::finish(){
+    // Join fragments across tiles
+    std::map<int32_t, FragmentTrack*> joined;
+    for(auto& e: mPendingMids){
+        auto itm = mMates.find(e.mHash);
+        if(itm == mMates.end()) continue;
+        uint8_t pairQual = std::min(itm->second, e.mQual);
+        itm->second = 0;
+        if(pairQual < mOpt->filterOpt->mMinGenoQual) continue;
+        auto itt = joined.find(e.mTid);
+        if(itt == joined.end()) itt = joined.insert(std::make_pair(e.mTid, new FragmentTrack(e.mTid))).first;
+        itt->second->add(e.mMidPos);
+    }
+    for(auto& e: joined){
+        e.second->seal();
+        mTracks.push_back(e.second);
+    }
+    std::unordered_map<size_t, uint8_t>().swap(mMates);
+    std::vector<PendingFragment>().swap(mPendingMids);
+    // Report buffer usage
+    uint64_t covReads = 0, fragments = 0;
+    size_t bytes = 0;
+    for(auto& e: mCovReads){
+        if(!e) continue;
+        covReads += e->mCount;
+        bytes += e->bytes();
+    }
+    for(auto& e: mTracks){
+        fragments += e->mCount;
+        bytes += e->mPacked.capacity();
+    }
+    util::loginfo("One pass buffered " + std::to_string(covReads) + " genotyping reads and " + std::to_string(fragments) + " fragments in " + std::to_string(bytes >> 20) + "MB");
+}
@@ -0,0 +1,304 @@
+#ifndef ONEPASS_H
+#define ONEPASS_H
+
+#include <map>
+#include <set>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+#include <htslib/sam.h>
+#include "svutil.h"
+#include "options.h"
+#include "dpbamrecord.h"
+#include "tile.h"
+#include "matejoin.h"
+
+/** class to store trimmed bam records back to back in one contiguous buffer\n
+ * each record is stored as [length of following bytes][bam1_core_t][qname, cigar, seq, qual, HP tag]\n
+ * all aux data other than the HP tag are dropped
+ */
+class BamBuffer{
+    public:
+        std::vector<uint8_t> mData; ///< packed records
+        size_t mHead = 0;           ///< offset of the first record not popped yet
+        uint64_t mCount = 0;        ///< records stored and not popped yet
+
+    public:
+        /** BamBuffer constructor */
+        BamBuffer(){}
+
+        /** BamBuffer destructor */
+        ~BamBuffer(){}
+
+        /** test whether this buffer has no records
+         * @return true if no records stored
+         */
+        inline bool empty() const {
+            return mHead >= mData.size();
+        }
+
+        /** get bytes occupied by this buffer
+         * @return bytes occupied
+         */
+        inline size_t bytes() const {
+            return mData.capacity();
+        }
+
+        /** get mapping position of the first record
+         * @return mapping position of the first record
+         */
+        inline int32_t frontPos() const {
+            bam1_core_t core;
+            memcpy(&core, &mData[mHead + sizeof(uint32_t)], sizeof(bam1_core_t));
+            return core.pos;
+        }
+
+        /** append a trimmed copy of an bam record
+         * @param b pointer to bam1_t struct
+         */
+        void push(const bam1_t* b);
+
+        /** drop the first record */
+        void popFront();
+
+        /** move all records into another buffer
+         * @param other pointer to BamBuffer to append records to
+         */
+        void moveTo(BamBuffer* other);
+
+        /** release all records */
+        inline void clear(){
+            std::vector<uint8_t>().swap(mData);
+            mHead = 0;
+            mCount = 0;
+        }
+
+        /** read one record at an offset into an bam1_t struct
+         * @param b pointer to bam1_t struct to store the record
+         * @param offset offset of record to read, updated to offset of next record
+         * @return true if one record read
+         */
+        bool next(bam1_t* b, size_t& offset) const;
+};
+
+/** class to iterate bam records on one contig either from bam file or from buffered records */
+class RecordReader{
+    public:
+        samFile* mFp = NULL;                         ///< bam file handle
+        hts_itr_t* mItr = NULL;                      ///< bam file iterator
+        const std::vector<BamBuffer*>* mBufs = NULL; ///< buffers to replay
+        uint32_t mBufIdx = 0;                        ///< index of buffer being replayed
+        uint32_t mBufEnd = 0;                        ///< index past the last buffer to replay
+        size_t mOffset = 0;                          ///< offset of next record in buffer being replayed
+
+    public:
+        /** RecordReader constructor to read records from bam file
+         * @param fp bam file handle
+         * @param idx bam index
+         * @param tid reference id to read
+         * @param beg starting position to read
+         * @param end ending position to read(exclusive)
+         */
+        RecordReader(samFile* fp, hts_idx_t* idx, int32_t tid, int32_t beg, int32_t end){
+            mFp = fp;
+            mItr = sam_itr_queryi(idx, tid, beg, end);
+        }
+
+        /** RecordReader constructor to replay buffered records
+         * @param bufs buffers to replay
+         * @param first index of the first buffer to replay
+         * @param last index past the last buffer to replay
+         */
+        RecordReader(const std::vector<BamBuffer*>& bufs, uint32_t first, uint32_t last){
+            mBufs = &bufs;
+            mBufIdx = first;
+            mBufEnd = last;
+        }
+
+        /** RecordReader destructor */
+        ~RecordReader(){
+            if(mItr) hts_itr_destroy(mItr);
+        }
+
+        /** read next record
+         * @param b pointer to bam1_t struct to store the record
+         * @return true if one record read
+         */
+        inline bool next(bam1_t* b){
+            if(mItr) return sam_itr_next(mFp, mItr, b) >= 0;
+            for(; mBufIdx < mBufEnd; ++mBufIdx, mOffset = 0){
+                if((*mBufs)[mBufIdx] && (*mBufs)[mBufIdx]->next(b, mOffset)) return true;
+            }
+            return false;
+        }
+};
+
+/** class to store fragment midpoints of read pairs on one contig, sorted and delta encoded once sealed */
+class FragmentTrack{
+    public:
+        int32_t mTid;                ///< reference id of midpoints
+        uint64_t mCount = 0;         ///< midpoints stored
+        std::vector<int32_t> mPos;   ///< midpoints not sealed yet
+        std::vector<uint8_t> mPacked; ///< sorted midpoints, each encoded as varint of distance to the previous one
+
+    public:
+        /** FragmentTrack constructor
+         * @param tid reference id of midpoints
+         */
+        FragmentTrack(int32_t tid) : mTid(tid) {}
+
+        /** FragmentTrack destructor */
+        ~FragmentTrack(){}
+
+        /** add one midpoint
+         * @param pos midpoint
+         */
+        inline void add(int32_t pos){
+            mPos.push_back(pos);
+        }
+
+        /** sort and encode all midpoints added */
+        void seal();
+
+        /** decode all midpoints sealed
+         * @param pos vector to store sorted midpoints
+         */
+        void unpack(std::vector<int32_t>& pos) const;
+};
+
+/** class to store the second read of an pair whose first read is on an earlier tile */
+struct PendingFragment{
+    size_t mHash;    ///< hash of the pair
+    int32_t mTid;    ///< reference id of the read
+    int32_t mMidPos; ///< fragment midpoint
+    uint8_t mQual;   ///< mapping quality of the read
+
+    /** PendingFragment constructor
+     * @param hash hash of the pair
+     * @param tid reference id of the read
+     * @param midPos fragment midpoint
+     * @param qual mapping quality of the read
+     */
+    PendingFragment(size_t hash, int32_t tid, int32_t midPos, uint8_t qual) : mHash(hash), mTid(tid), mMidPos(midPos), mQual(qual) {}
+};
+
+/** class to collect records needed by genotyping while one tile is scanned in one pass mode\n
+ * reads near dense SR/DP evidences are buffered and fragment midpoints of all read pairs are recorded for read-depth counting\n
+ * records beyond the owned range of the tile are only used to find evidences
+ */
+class TileCollector{
+    public:
+        Options* mOpt;                 ///< pointer to Options
+        GenomeTile mTile;              ///< tile collected
+        BamBuffer* mCovReads;          ///< reads near dense evidences for genotyping
+        BamBuffer* mLookback;          ///< recent reads which may be needed by evidences found later
+        FragmentTrack* mTrack;         ///< fragment midpoints of pairs joined on this tile
+        int32_t mReadSep;              ///< maximum distance between two junctions of the same SR cluster
+        int32_t mPairTol;              ///< maximum distance between two DPs of the same DP cluster
+        int32_t mFlank;                ///< reads within this distance of dense evidences are kept
+        int32_t mContext;              ///< reads within this distance of the tile are scanned for evidences
+        int32_t mHotEnd;               ///< reads starting at or before this position are kept
+        std::vector<int32_t> mJcts;    ///< junction positions of current read
+        std::multiset<int32_t> mRecentJcts;                                          ///< recent junction positions
+        std::vector<std::deque<std::pair<int32_t, std::pair<int32_t, int32_t>>>> mRecentDPs; ///< recent <pos, <mtid, mpos>> of DP reads of each SV type
+        SamePosReads mLastAlignedPosReads;                                           ///< reads mapped at last position checked
+        MateJoinTable<uint8_t> mQualities;                                           ///< mapping quality of first reads whose mate are on this tile
+        std::unordered_map<size_t, uint8_t> mMates;                                  ///< mapping quality of first reads whose mate are beyond this tile
+        std::vector<PendingFragment> mPendingMids;                                   ///< second reads whose mate are before this tile
+
+    public:
+        /** TileCollector constructor
+         * @param opt pointer to Options
+         * @param tile tile to collect
+         */
+        TileCollector(Options* opt, const GenomeTile& tile);
+
+        /** TileCollector destructor */
+        ~TileCollector(){
+            if(mCovReads) delete mCovReads;
+            if(mLookback) delete mLookback;
+            if(mTrack) delete mTrack;
+        }
+
+        /** collect one record, records must be fed in coordinate order
+         * @param b pointer to bam1_t struct fetched from [mTile.mBeg - mContext, mTile.mEnd + mContext)
+         */
+        void collect(bam1_t* b);
+
+        /** finish collecting, reads still in lookback are dropped */
+        void finish();
+
+        /** keep all reads in lookback and reads starting within mFlank after an dense evidence
+         * @param hi largest position of the dense evidence
+         */
+        void anchor(int32_t hi);
+
+        /** get SV type an bam record supports as a DP read, same filter as the scanner is applied
+         * @param b pointer to bam1_t struct
+         * @return SV type b supports, -1 if none
+         */
+        int32_t getDPSVType(const bam1_t* b);
+
+        /** get junction positions of an bam record, same rule as JunctionMap::insertJunction is applied
+         * @param b pointer to bam1_t struct
+         * @param jcts vector to store junction positions on reference
+         */
+        void getJunctions(const bam1_t* b, std::vector<int32_t>& jcts);
+
+        /** record fragment midpoint of an read pair
+         * @param b pointer to bam1_t struct of one read in pair
+         */
+        void addFragment(bam1_t* b);
+};
+
+/** class to store records collected on all tiles in one pass mode */
+class OnePassStore{
+    public:
+        Options* mOpt;                             ///< pointer to Options
+        TileList mTiles;                           ///< tiles scanned
+        std::vector<BamBuffer*> mCovReads;         ///< reads near dense evidences of each tile
+        std::vector<FragmentTrack*> mTracks;       ///< fragment midpoint tracks
+        std::unordered_map<size_t, uint8_t> mMates;                                ///< mapping quality of first reads whose mate are on later tiles
+        std::vector<PendingFragment> mPendingMids;                                 ///< second reads whose mate are on earlier tiles
+
+    public:
+        /** OnePassStore constructor
+         * @param opt pointer to Options
+         * @param tiles tiles to be scanned
+         */
+        OnePassStore(Options* opt, const TileList& tiles){
+            mOpt = opt;
+            mTiles = tiles;
+            mCovReads.resize(tiles.size(), NULL);
+        }
+
+        /** OnePassStore destructor */
+        ~OnePassStore(){
+            for(auto& e: mCovReads) if(e) delete e;
+            for(auto& e: mTracks) delete e;
+        }
+
+        /** take over records collected on one tile, must be called in tile order
+         * @param tc pointer to TileCollector
+         */
+        void merge(TileCollector* tc);
+
+        /** join fragments across tiles, must be called after all tiles merged */
+        void finish();
+
+        /** get index range of tiles on one contig
+         * @param tid reference id
+         * @param first index of the first tile on tid
+         * @param last index past the last tile on tid
+         */
+        inline void tileRange(int32_t tid, uint32_t& first, uint32_t& last) const {
+            first = std::lower_bound(mTiles.begin(), mTiles.end(), tid, [](const GenomeTile& t, int32_t i){return t.mTid < i;}) - mTiles.begin();
+            last = std::upper_bound(mTiles.begin(), mTiles.end(), tid, [](int32_t i, const GenomeTile& t){return i < t.mTid;}) - mTiles.begin();
+        }
+};
+
+#endif
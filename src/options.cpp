@@ -3,6 +3,15 @@
 Options::Options(){
     madCutoff = 9;
     nthread = 8;
+    tileSize = 10000000;
+    onePass = false;
+    streamSR = false;
+    libFullScan = false;
+    libSample = false;
+    libSampleSpots = 4096;
+    libSampleReads = 256;
+    libRecompute = false;
+    tpool = {NULL, 0};
     bcfOut = "out.bcf";
     tsvOut = "out.tsv";
     filterOpt = new SVFilter();
@@ -12,6 +21,8 @@ Options::Options(){
     softEnv->cmp += "version: " + softEnv->version + "\n";
     softEnv->cmp += "updated: " + std::string(__TIME__) + " " + std::string(__DATE__);
     libInfo = NULL;
+    refStore = NULL;
+    nGaps = NULL;
     contigNum = 0;
 }
 
@@ -19,6 +30,9 @@ Options::~Options(){
     if(filterOpt) delete filterOpt;
     if(softEnv) delete softEnv;
     if(libInfo) delete libInfo;
+    if(refStore) delete refStore;
+    if(nGaps) delete nGaps;
+    if(tpool.pool) hts_tpool_destroy(tpool.pool);
 }
 
 void Options::validate(){
@@ -35,8 +49,16 @@ void Options::update(int argc, char** argv){
         softEnv->cmd.append(argv[i]);
         softEnv->cmd.append(" ");
     }
+    // create htslib thread pool shared by all file handles
+    tpool.pool = hts_tpool_init(nthread);
+    if(!tpool.pool) util::loginfo("Failed to create htslib thread pool, decompress bam with single thread");
     // get library information
     libInfo = getLibInfo(bamfile);
+    // map reference genome store
+    refStore = new RefStore();
+    refStore->open(genome);
+    nGaps = new NGapIndex();
+    nGaps->open(genome, refStore);
     // update SV types to discover
     std::vector<std::string> svt = {"INV", "DEL", "DUP", "INS", "BND"};
     std::string allSVT;
@@ -65,35 +87,169 @@ void Options::update(int argc, char** argv){
 LibraryInfo* Options::getLibInfo(const std::string& bam){
     LibraryInfo* libInfo = new LibraryInfo();
     samFile* fp = sam_open(bam.c_str(), "r");
+    attachThreadPool(fp);
     bam_hdr_t* h = sam_hdr_read(fp);
-    bam1_t* b = bam_init1();
-    std::vector<int32_t> vecISize, readLen;
-    const uint16_t BAM_SKIP_RECORD_MASK = (BAM_FREAD2 | BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP);
-    while(sam_read1(fp, h, b) >= 0){
-        if(b->core.flag & BAM_SKIP_RECORD_MASK) continue;
-        readLen.push_back(b->core.l_qseq);
-        if(b->core.flag & BAM_FPAIRED && b->core.tid == b->core.mtid){
-            vecISize.push_back(std::abs(b->core.isize));
+    std::string libCache = bam + ".sver.lib";
+    std::string libKey = getLibCacheKey(bam, h);
+    if(!libRecompute && loadLibCache(libCache, libKey, libInfo)){
+        util::loginfo("Library information loaded from " + libCache);
+    }else{
+        LibraryProfiler profiler;
+        hts_idx_t* idx = libSample ? sam_index_load(fp, bam.c_str()) : NULL;
+        if(idx){
+            sampleLibInfo(fp, h, idx, profiler, libInfo);
+            hts_idx_destroy(idx);
+        }else{
+            if(libSample) util::loginfo("Index of " + bam + " not found, estimate library information sequentially");
+            // Stop once estimates converged only if sampling requested, otherwise scan all records
+            bool earlyStop = libSample && !libFullScan;
+            bam1_t* b = bam_init1();
+            while(sam_read1(fp, h, b) >= 0){
+                if(!profiler.add(b)) continue;
+                if(earlyStop && profiler.converged()) break;
+            }
+            bam_destroy1(b);
         }
+        libInfo->mReadLen = profiler.mReadLenHist.median();
+        libInfo->mMedian = profiler.mISizeHist.median();
+        libInfo->mMad = profiler.mISizeHist.mad(libInfo->mMedian);
+        saveLibCache(libCache, libKey, libInfo);
     }
-    libInfo->mReadLen = statutil::median(readLen);
-    libInfo->mMedian = statutil::median(vecISize);
-    libInfo->mMad = statutil::mad(vecISize, libInfo->mMedian);
     libInfo->mMaxNormalISize = libInfo->mMedian + (5 * libInfo->mMad);
     libInfo->mMinNormalISize = std::max(0, libInfo->mMedian - (5 * libInfo->mMad));
     libInfo->mMinISizeCutoff = std::max(0, libInfo->mMedian - (madCutoff * libInfo->mMad));
     libInfo->mMaxISizeCutoff = std::max(libInfo->mMedian + (madCutoff * libInfo->mMad), 2 * libInfo->mReadLen);
     libInfo->mMaxISizeCutoff = std::max(libInfo->mMaxISizeCutoff, 600);
     libInfo->mContigNum = h->n_targets;
+    if(libInfo->mContigNum > 65535) util::errorExit("At most 65535 contigs are supported, evidence records store reference id in 16 bits");
     libInfo->mVarisize = std::max(libInfo->mReadLen, libInfo->mMaxNormalISize);
     sam_close(fp);
-    bam_destroy1(b);
     bam_hdr_destroy(h);
     return libInfo;
 }
 
+std::string Options::getLibCacheKey(const std::string& bam, const bam_hdr_t* h){
+    // Bam file path, size and modification time
+    struct stat info;
+    int64_t fsize = 0, mtime = 0;
+    if(stat(bam.c_str(), &info) == 0){
+        fsize = info.st_size;
+        mtime = info.st_mtime;
+    }
+    // FNV-1a checksum of header text
+    uint64_t checksum = 14695981039346656037ULL;
+    for(uint32_t i = 0; i < h->l_text; ++i){
+        checksum ^= (uint8_t)h->text[i];
+        checksum *= 1099511628211ULL;
+    }
+    // Estimation method
+    std::string method = libSample ? "sample" : "scan";
+    if(libSample) method += ":" + std::to_string(libSampleSpots) + ":" + std::to_string(libSampleReads);
+    if(libSample && libFullScan) method += ":full";
+    std::stringstream ss;
+    ss << util::abspath(bam) << "\t" << fsize << "\t" << mtime << "\t" << checksum << "\t" << method;
+    return ss.str();
+}
+
+bool Options::loadLibCache(const std::string& cache, const std::string& key, LibraryInfo* libInfo){
+    std::ifstream fr(cache);
+    if(!fr.is_open()) return false;
+    std::string tmpStr;
+    if(!std::getline(fr, tmpStr) || tmpStr != key) return false;
+    std::vector<std::string> vstr;
+    int32_t fields = 0;
+    while(std::getline(fr, tmpStr)){
+        util::split(tmpStr, vstr, "\t");
+        if(vstr.size() != 2) continue;
+        if(vstr[0] == "ReadLen") libInfo->mReadLen = std::atoi(vstr[1].c_str());
+        else if(vstr[0] == "Median") libInfo->mMedian = std::atoi(vstr[1].c_str());
+        else if(vstr[0] == "MAD") libInfo->mMad = std::atoi(vstr[1].c_str());
+        else if(vstr[0] == "SampledReads") libInfo->mSampledReads = std::atoll(vstr[1].c_str());
+        else if(vstr[0] == "ReadLenErr") libInfo->mReadLenErr = std::atof(vstr[1].c_str());
+        else if(vstr[0] == "MedianErr") libInfo->mMedianErr = std::atof(vstr[1].c_str());
+        else if(vstr[0] == "MADErr") libInfo->mMadErr = std::atof(vstr[1].c_str());
+        else continue;
+        ++fields;
+    }
+    return fields == 7;
+}
+
+void Options::saveLibCache(const std::string& cache, const std::string& key, const LibraryInfo* libInfo){
+    std::ofstream fw(cache);
+    if(!fw.is_open()){
+        util::loginfo("Library cache " + cache + " can not be written, skip saving library information");
+        return;
+    }
+    fw << key << "\n";
+    fw << "ReadLen\t" << libInfo->mReadLen << "\n";
+    fw << "Median\t" << libInfo->mMedian << "\n";
+    fw << "MAD\t" << libInfo->mMad << "\n";
+    fw << "SampledReads\t" << libInfo->mSampledReads << "\n";
+    fw << "ReadLenErr\t" << libInfo->mReadLenErr << "\n";
+    fw << "MedianErr\t" << libInfo->mMedianErr << "\n";
+    fw << "MADErr\t" << libInfo->mMadErr << "\n";
+    fw.close();
+}
+
+void Options::sampleLibInfo(samFile* fp, bam_hdr_t* h, hts_idx_t* idx, LibraryProfiler& profiler, LibraryInfo* libInfo){
+    // Cumulative length of contigs with mapped reads
+    std::vector<int64_t> cumLen(h->n_targets, 0);
+    int64_t genomeLen = 0;
+    for(int32_t i = 0; i < h->n_targets; ++i){
+        uint64_t mapped = 0;
+        uint64_t unmapped = 0;
+        if(hts_idx_get_stat(idx, i, &mapped, &unmapped) < 0 || mapped) genomeLen += h->target_len[i];
+        cumLen[i] = genomeLen;
+    }
+    // Round number of positions to power of 2
+    int32_t nbits = 0;
+    while(nbits < 30 && (1 << (nbits + 1)) <= libSampleSpots) ++nbits;
+    int32_t nspots = (1 << nbits);
+    // Visit positions
+    profiler.mCheckStep = (uint64_t)libSampleReads * 16;
+    profiler.mMinStableChecks = 4;
+    LibraryProfiler halves[2];
+    bam1_t* b = bam_init1();
+    int32_t visited = 0;
+    for(int32_t k = 0; k < nspots && genomeLen > 0; ++k){
+        int32_t r = 0;
+        for(int32_t j = 0; j < nbits; ++j) if(k & (1 << j)) r |= (1 << (nbits - 1 - j));
+        int64_t gpos = (2 * (int64_t)r + 1) * genomeLen / (2 * (int64_t)nspots);
+        int32_t tid = std::upper_bound(cumLen.begin(), cumLen.end(), gpos) - cumLen.begin();
+        if(tid >= h->n_targets) continue;
+        int32_t pos = gpos - (tid > 0 ? cumLen[tid - 1] : 0);
+        hts_itr_t* itr = sam_itr_queryi(idx, tid, pos, h->target_len[tid]);
+        if(!itr) continue;
+        bool converged = false;
+        int32_t nreads = 0;
+        while(nreads < libSampleReads && sam_itr_next(fp, itr, b) >= 0){
+            if(!profiler.add(b)) continue;
+            halves[visited & 1].add(b);
+            ++nreads;
+            if(profiler.converged()) converged = true;
+        }
+        hts_itr_destroy(itr);
+        ++visited;
+        if(converged && !libFullScan) break;
+    }
+    bam_destroy1(b);
+    util::loginfo("Library information estimated from " + std::to_string(visited) + " positions sampled");
+    // Sampling error, difference of two halves is about twice of the standard error of all
+    int32_t readLen[2], med[2], mad[2];
+    for(int32_t i = 0; i < 2; ++i){
+        readLen[i] = halves[i].mReadLenHist.median();
+        med[i] = halves[i].mISizeHist.median();
+        mad[i] = halves[i].mISizeHist.mad(med[i]);
+    }
+    libInfo->mSampledReads = profiler.mReadLenHist.mTotal;
+    libInfo->mReadLenErr = std::abs(readLen[0] - readLen[1]) / 2.0;
+    libInfo->mMedianErr = std::abs(med[0] - med[1]) / 2.0;
+    libInfo->mMadErr = std::abs(mad[0] - mad[1]) / 2.0;
+}
+
 void Options::getValidRegion(){
     samFile* fp = sam_open(bamfile.c_str(), "r");
+    attachThreadPool(fp);
     bam_hdr_t* h = sam_hdr_read(fp);
     validRegions.resize(h->n_targets);
     // Parse valid region if exists
@@ -9,7 +9,9 @@
 #include <cstdint>
 #include <sstream>
 #include <htslib/sam.h>
+#include <htslib/thread_pool.h>
 #include "statutil.h"
+#include "refstore.h"
 #include "util.h"
 
 /** class to store library information */
@@ -25,6 +27,10 @@ struct LibraryInfo{
     bool mIsHaploTagged = false; ///< bam has HP tag if true
     int32_t mContigNum = 0;      ///< maximum contig number in library
     int32_t mVarisize = 0;       ///< std::max(mMaxNormalISize, mReadLen), mMaxDPVarSize equqls this value
+    int64_t mSampledReads = 0;   ///< reads used to estimate library information if estimated by sampling, 0 otherwise
+    double mReadLenErr = 0;      ///< sampling error of read length
+    double mMedianErr = 0;       ///< sampling error of isize median
+    double mMadErr = 0;          ///< sampling error of isize mad
     
     /** LibraryInfo constructor */
     LibraryInfo(){}
@@ -48,6 +54,12 @@ struct LibraryInfo{
         ss << "Library Haplotype Tagged: " << std::boolalpha << mIsHaploTagged << "\n";
         ss << "Contig/Chrosome Number: " << mContigNum << "\n";
         ss << "Maximum Varsize : " << mVarisize;
+        if(mSampledReads){
+            ss << "\nSampled Reads: " << mSampledReads << "\n";
+            ss << "Read Length Sampling Error: " << mReadLenErr << "\n";
+            ss << "ISize Median Sampling Error: " << mMedianErr << "\n";
+            ss << "ISize MAD Sampling Error: " << mMadErr;
+        }
         return ss.str();
     }
 
@@ -82,6 +94,57 @@ struct LibraryInfo{
     }
 };
 
+/** class to estimate library information from bam records with bounded memory */
+struct LibraryProfiler{
+    statutil::Histogram mISizeHist;     ///< histogram of abs(isize) of first read of pairs on the same contig
+    statutil::Histogram mReadLenHist;   ///< histogram of read length
+    uint64_t mCheckStep = 1000000;      ///< estimates are checked for convergence every mCheckStep reads
+    int32_t mMinStableChecks = 5;       ///< estimates are converged if unchanged in mMinStableChecks consecutive checks
+    int32_t mStableChecks = 0;          ///< consecutive checks in which estimates are unchanged
+    int32_t mReadLen = -1;              ///< read length estimated at last check
+    int32_t mMedian = -1;               ///< isize median estimated at last check
+    int32_t mMad = -1;                  ///< isize mad estimated at last check
+
+    /** LibraryProfiler constructor
+     * @param maxISize maximum isize counted exactly
+     * @param maxReadLen maximum read length counted exactly
+     */
+    LibraryProfiler(int32_t maxISize = 100000, int32_t maxReadLen = 100000) : mISizeHist(maxISize), mReadLenHist(maxReadLen) {}
+
+    /** LibraryProfiler destructor */
+    ~LibraryProfiler(){}
+
+    /** count one bam record if it is valid for library estimation
+     * @param b pointer to bam1_t struct
+     * @return true if b is counted
+     */
+    inline bool add(const bam1_t* b){
+        const uint16_t BAM_SKIP_RECORD_MASK = (BAM_FREAD2 | BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP);
+        if(b->core.flag & BAM_SKIP_RECORD_MASK) return false;
+        mReadLenHist.add(b->core.l_qseq);
+        if(b->core.flag & BAM_FPAIRED && b->core.tid == b->core.mtid){
+            mISizeHist.add(std::abs(b->core.isize));
+        }
+        return true;
+    }
+
+    /** test whether estimates are converged, should be called after each record counted
+     * @return true if estimates are unchanged in the last mMinStableChecks checks
+     */
+    inline bool converged(){
+        if(mReadLenHist.mTotal == 0 || mReadLenHist.mTotal % mCheckStep) return false;
+        int32_t readLen = mReadLenHist.median();
+        int32_t med = mISizeHist.median();
+        int32_t mad = mISizeHist.mad(med);
+        if(readLen == mReadLen && med == mMedian && mad == mMad) ++mStableChecks;
+        else mStableChecks = 0;
+        mReadLen = readLen;
+        mMedian = med;
+        mMad = mad;
+        return mStableChecks >= mMinStableChecks;
+    }
+};
+
 /** class to store various filter options to SVs or SV supporting SR/DP reads */
 struct SVFilter{
     int32_t mMinRefSep = 50;           ///< minimal reference seperation needed for an split alignment used to compute SV
@@ -96,6 +159,7 @@ struct SVFilter{
     int32_t mMinDupSize = 100;         ///< minimal duplication size needed for an DP record used to compute SV
     uint32_t mMinGenoQual = 5;         ///< minimal mapping quality for genotyping
     uint32_t mGraphPruning = 100000;   ///< PE graph pruning cutoff
+    int32_t mMaxEvidenceDensity = 2000; ///< maximum SR/DP records in one clustering window, records of denser regions are subsampled
     int32_t mMaxReadPerSV = 100000;    ///< maximum valid split-reads sampled to analysis one SV event
     int32_t mMinGapOfCSSVRef = 15;     ///< minimal middle gap length needed for an SR consensus against SV ref seq alignment
     int32_t mMaxCoordDevOfCSSVRef = 5; ///< maximum gap start/end length allowed for the non-gapped partner of an valid SR consensus ~ SV ref seq alignment
@@ -175,11 +239,21 @@ class Options{
         std::vector<int32_t> svtypes; ///< sv types to discovery(for commandline argument parsing)
         std::set<int32_t> SVTSet;     ///< predefined sv types to compute [INV, DEL, DUP, INS, BND]
         int32_t nthread;              ///< threads used to process REF/ALT read/pair assignment
+        int32_t tileSize;             ///< genomic tile size processed by one thread each time
+        bool onePass;                 ///< decode bam once and buffer records needed by genotyping
+        bool streamSR;                ///< classify split reads whose parts are all known from SA tag while scanning
+        bool libFullScan;             ///< do not stop library sampling once estimates converged, sequential scan always reads all records
+        bool libSample;               ///< estimate library information from reads sampled across contigs by bam index
+        int32_t libSampleSpots;       ///< maximum number of positions sampled across contigs
+        int32_t libSampleReads;       ///< maximum number of reads sampled at each position
+        bool libRecompute;            ///< estimate library information even if a valid library cache file exists
+        htsThreadPool tpool;          ///< htslib thread pool shared by all bam/bcf file handles
         std::mutex logMtx;            ///< mutex locked to output log information
-        std::mutex traMtx;            ///< mutex locked to process translocations
         int32_t contigNum;            ///< max contig numbers in library bam
         std::set<int32_t> svRefID;    ///< SV occuring reference id
         LibraryInfo* libInfo;         ///< library information for the currently analyzed bam
+        RefStore* refStore;           ///< 2-bit packed reference genome shared by all threads
+        NGapIndex* nGaps;             ///< N gaps of reference genome
         SVFilter* filterOpt;          ///< filter options
         PassOptions* passOpt;         ///< high quality SV threshold
         MSAOpt* msaOpt;               ///< MSA options
@@ -192,6 +266,13 @@ class Options{
         /** Options destructor */
         ~Options();
 
+        /** attach shared htslib thread pool to an opened file handle
+         * @param fp pointer to htsFile
+         */
+        inline void attachThreadPool(htsFile* fp){
+            if(fp && tpool.pool) hts_set_thread_pool(fp, &tpool);
+        }
+
         /** validate some arguments passed */
         void validate();
 
@@ -206,6 +287,39 @@ class Options{
          */
         LibraryInfo* getLibInfo(const std::string& bam);
 
+        /** get key of library cache file of a bam, which changes if bam or estimation method changes
+         * @param bam bam file path
+         * @param h pointer to bam header
+         * @return key of library cache file
+         */
+        std::string getLibCacheKey(const std::string& bam, const bam_hdr_t* h);
+
+        /** load library information from cache file if its key matches
+         * @param cache library cache file path
+         * @param key key of library cache file expected
+         * @param libInfo pointer to LibraryInfo to store library information loaded
+         * @return true if library information loaded
+         */
+        bool loadLibCache(const std::string& cache, const std::string& key, LibraryInfo* libInfo);
+
+        /** save library information to cache file
+         * @param cache library cache file path
+         * @param key key of library cache file
+         * @param libInfo pointer to LibraryInfo to save
+         */
+        void saveLibCache(const std::string& cache, const std::string& key, const LibraryInfo* libInfo);
+
+        /** estimate library information from reads at evenly spaced positions across contigs\n
+         * positions are visited in bit-reversed order so that any prefix of them is spread across the genome\n
+         * sampling error is estimated by the difference of estimates from two interleaved halves of positions
+         * @param fp pointer to samFile opened
+         * @param h pointer to bam header
+         * @param idx pointer to bam index
+         * @param profiler reference of LibraryProfiler to count sampled reads
+         * @param libInfo pointer to LibraryInfo to store sampling information
+         */
+        void sampleLibInfo(samFile* fp, bam_hdr_t* h, hts_idx_t* idx, LibraryProfiler& profiler, LibraryInfo* libInfo);
+
         /** create valid regions by exclude invalid regions */
         void getValidRegion();
 };
@@ -0,0 +1,79 @@
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <array>
+#include <vector>
+#include <future>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include "ThreadPool.h"
+
+/** class to sort records by an unsigned integer key with stable parallel LSD radix sort\n
+ * records are split into one chunk per thread, each chunk counts the digits of its records and scatters\n
+ * them to offsets reserved after all chunks counted, so records with equal key keep their input order
+ */
+class RadixSorter{
+    public:
+        static const size_t mMinChunk = 1 << 16; ///< minimum records of one chunk
+
+    public:
+        /** sort records by the lower bytes of an key, records with equal key keep their input order\n
+         * sort by a wider key by calling this from the least significant key to the most significant key
+         * @param recs records to sort
+         * @param key functor to get key of one record
+         * @param nbytes lower bytes of key to sort by, at most 8
+         * @param nthread threads to use
+         */
+        template<typename T, typename KeyFn>
+        static void sort(std::vector<T>& recs, KeyFn key, uint32_t nbytes, int32_t nthread){
+            size_t n = recs.size();
+            if(n < 2) return;
+            uint32_t nchunk = std::max((size_t)1, std::min((size_t)std::max(1, nthread), n / mMinChunk));
+            std::vector<size_t> chunkBeg(nchunk + 1);
+            for(uint32_t c = 0; c <= nchunk; ++c) chunkBeg[c] = n * c / nchunk;
+            std::vector<std::array<size_t, 256>> cnts(nchunk);
+            std::vector<T> tmp(recs); // buffer to scatter records into, records need not be default constructible
+            T* src = recs.data();
+            T* dst = tmp.data();
+            ThreadPool::ThreadPool pool(nchunk);
+            std::vector<std::future<void>> rets(nchunk);
+            for(uint32_t shift = 0; shift < 8 * nbytes; shift += 8){
+                // Count digits of each chunk
+                for(uint32_t c = 0; c < nchunk; ++c){
+                    rets[c] = pool.enqueue([&, c, shift](){
+                        std::array<size_t, 256>& cnt = cnts[c];
+                        cnt.fill(0);
+                        for(size_t i = chunkBeg[c]; i < chunkBeg[c + 1]; ++i) ++cnt[(key(src[i]) >> shift) & 0xff];
+                    });
+                }
+                for(auto& e: rets) e.get();
+                // Skip digit shared by all records
+                size_t d0 = (key(src[0]) >> shift) & 0xff;
+                size_t same = 0;
+                for(uint32_t c = 0; c < nchunk; ++c) same += cnts[c][d0];
+                if(same == n) continue;
+                // Records of one digit are placed in chunk order
+                size_t off = 0;
+                for(uint32_t d = 0; d < 256; ++d){
+                    for(uint32_t c = 0; c < nchunk; ++c){
+                        size_t k = cnts[c][d];
+                        cnts[c][d] = off;
+                        off += k;
+                    }
+                }
+                // Scatter records of each chunk
+                for(uint32_t c = 0; c < nchunk; ++c){
+                    rets[c] = pool.enqueue([&, c, shift](){
+                        std::array<size_t, 256>& cnt = cnts[c];
+                        for(size_t i = chunkBeg[c]; i < chunkBeg[c + 1]; ++i) dst[cnt[(key(src[i]) >> shift) & 0xff]++] = src[i];
+                    });
+                }
+                for(auto& e: rets) e.get();
+                std::swap(src, dst);
+            }
+            if(src != recs.data()) recs.swap(tmp);
+        }
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "refstore.h"
+
+void RefStore::open(const std::string& genome){
+    // FASTA size and modification time are used to detect stale store
+    struct stat info;
+    int64_t fsize = 0, mtime = 0;
+    if(stat(genome.c_str(), &info) == 0){
+        fsize = info.st_size;
+        mtime = info.st_mtime;
+    }
+    std::string path = genome + ".sver.2bit";
+    FILE* fp = fopen(path.c_str(), "rb");
+    if(fp){
+        if(load(fp, fsize, mtime)){
+            util::loginfo("Reference store " + path + " loaded");
+            return;
+        }
+        fclose(fp);
+    }
+    // Convert into an temporary file first, so other runs never map an partial store
+    util::loginfo("Start converting reference into " + path);
+    std::string tmp = path + "." + std::to_string(getpid()) + ".tmp";
+    fp = fopen(tmp.c_str(), "wb+");
+    if(fp){
+        build(genome, fp, fsize, mtime);
+        fclose(fp);
+        fp = NULL;
+        if(std::rename(tmp.c_str(), path.c_str()) == 0) fp = fopen(path.c_str(), "rb");
+        else std::remove(tmp.c_str());
+    }
+    if(!fp){
+        util::loginfo("Reference store " + path + " can not be written, convert reference into temporary file");
+        fp = tmpfile();
+        if(!fp) util::errorExit("Failed to create temporary file for reference store");
+        build(genome, fp, fsize, mtime);
+    }
+    if(!load(fp, fsize, mtime)) util::errorExit("Failed to load reference store converted from " + genome);
+    util::loginfo("Finish converting reference into " + path);
+}
+
+void RefStore::close(){
+    if(mMap) munmap((void*)mMap, mBytes);
+    if(mFp) fclose(mFp);
+    mMap = NULL;
+    mFp = NULL;
+    mBytes = 0;
+    mContigs.clear();
+    mNames.clear();
+    mIdx.clear();
+}
+
+void RefStore::slice(const char* chr, int32_t beg, int32_t end, std::string& seq) const {
+    const Contig& ctg = mContigs[contigIndex(chr)];
+    beg = std::max(beg, 0);
+    end = std::min(end, (int32_t)ctg.mLen);
+    seq.clear();
+    if(beg >= end) return;
+    // Decode bases
+    static const char bases[4] = {'A', 'C', 'G', 'T'};
+    const uint8_t* packed = mMap + ctg.mSeqOffset;
+    seq.resize(end - beg);
+    for(int32_t p = beg; p < end; ++p) seq[p - beg] = bases[(packed[p >> 2] >> ((p & 3) << 1)) & 3];
+    // Mask N runs overlapping slice, the first one is found by binary search on run ends
+    const uint32_t* runs = (const uint32_t*)(mMap + ctg.mNOffset);
+    uint32_t lo = 0, hi = ctg.mNRuns;
+    while(lo < hi){
+        uint32_t mid = (lo + hi) >> 1;
+        if(runs[2 * mid + 1] <= (uint32_t)beg) lo = mid + 1;
+        else hi = mid;
+    }
+    for(uint32_t k = lo; k < ctg.mNRuns && runs[2 * k] < (uint32_t)end; ++k){
+        int32_t s = std::max((int32_t)runs[2 * k], beg);
+        int32_t e = std::min((int32_t)runs[2 * k + 1], end);
+        std::fill(seq.begin() + (s - beg), seq.begin() + (e - beg), 'N');
+    }
+}
+
+void RefStore::build(const std::string& genome, FILE* fp, int64_t fsize, int64_t mtime){
+    faidx_t* fai = fai_load(genome.c_str());
+    if(!fai) util::errorExit("Failed to load FASTA index of " + genome);
+    Header hdr;
+    memset(&hdr, 0, sizeof(Header));
+    memcpy(hdr.mMagic, "SVER2BIT", 8);
+    hdr.mVersion = 1;
+    hdr.mContigNum = faidx_nseq(fai);
+    hdr.mFastaSize = fsize;
+    hdr.mFastaMtime = mtime;
+    fwrite(&hdr, sizeof(Header), 1, fp);
+    uint64_t offset = sizeof(Header);
+    std::vector<Contig> contigs(hdr.mContigNum);
+    std::vector<uint8_t> packed;
+    std::vector<uint32_t> runs;
+    const uint8_t pad[4] = {0, 0, 0, 0};
+    for(uint32_t i = 0; i < hdr.mContigNum; ++i){
+        // Each contig is parsed from FASTA only once
+        const char* name = faidx_iseq(fai, i);
+        int32_t len = faidx_seq_len(fai, name);
+        int32_t seqlen = -1;
+        char* seq = faidx_fetch_seq(fai, name, 0, len - 1, &seqlen);
+        if(!seq || seqlen != len) util::errorExit("Failed to fetch contig " + std::string(name) + " from " + genome);
+        packed.assign((len + 3) >> 2, 0);
+        runs.clear();
+        for(int32_t p = 0; p < len; ++p){
+            uint8_t code = 0;
+            switch(seq[p]){
+                case 'A': case 'a': code = 0; break;
+                case 'C': case 'c': code = 1; break;
+                case 'G': case 'g': code = 2; break;
+                case 'T': case 't': code = 3; break;
+                default:// extend last N run or start a new one
+                    if(!runs.empty() && runs.back() == (uint32_t)p) runs.back() = p + 1;
+                    else{
+                        runs.push_back(p);
+                        runs.push_back(p + 1);
+                    }
+                    continue;
+            }
+            packed[p >> 2] |= (code << ((p & 3) << 1));
+        }
+        free(seq);
+        contigs[i].mLen = len;
+        contigs[i].mSeqOffset = offset;
+        fwrite(packed.data(), 1, packed.size(), fp);
+        offset += packed.size();
+        // Keep N runs 4-byte aligned
+        fwrite(pad, 1, (4 - offset % 4) % 4, fp);
+        offset += (4 - offset % 4) % 4;
+        contigs[i].mNOffset = offset;
+        contigs[i].mNRuns = runs.size() / 2;
+        fwrite(runs.data(), sizeof(uint32_t), runs.size(), fp);
+        offset += runs.size() * sizeof(uint32_t);
+    }
+    // Append contig index and fill its offset into header
+    hdr.mIndexOffset = offset;
+    for(uint32_t i = 0; i < hdr.mContigNum; ++i){
+        const char* name = faidx_iseq(fai, i);
+        uint32_t nameLen = strlen(name);
+        fwrite(&nameLen, sizeof(uint32_t), 1, fp);
+        fwrite(name, 1, nameLen, fp);
+        fwrite(&contigs[i], sizeof(Contig), 1, fp);
+    }
+    fseek(fp, 0, SEEK_SET);
+    fwrite(&hdr, sizeof(Header), 1, fp);
+    if(fflush(fp) != 0 || ferror(fp)) util::errorExit("Failed to write reference store converted from " + genome);
+    fai_destroy(fai);
+}
+
+bool RefStore::load(FILE* fp, int64_t fsize, int64_t mtime){
+    struct stat info;
+    if(fstat(fileno(fp), &info) != 0 || (size_t)info.st_size < sizeof(Header)) return false;
+    size_t bytes = info.st_size;
+    void* map = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fileno(fp), 0);
+    if(map == MAP_FAILED) return false;
+    const uint8_t* base = (const uint8_t*)map;
+    Header hdr;
+    memcpy(&hdr, base, sizeof(Header));
+    bool valid = memcmp(hdr.mMagic, "SVER2BIT", 8) == 0 && hdr.mVersion == 1 &&
+                 hdr.mFastaSize == fsize && hdr.mFastaMtime == mtime && hdr.mIndexOffset <= bytes;
+    // Load contig index
+    std::vector<Contig> contigs;
+    std::vector<std::string> names;
+    uint64_t offset = hdr.mIndexOffset;
+    for(uint32_t i = 0; valid && i < hdr.mContigNum; ++i){
+        uint32_t nameLen = 0;
+        if(offset + sizeof(uint32_t) > bytes) valid = false;
+        else memcpy(&nameLen, base + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        if(!valid || offset + nameLen + sizeof(Contig) > bytes){
+            valid = false;
+            break;
+        }
+        names.push_back(std::string((const char*)base + offset, nameLen));
+        offset += nameLen;
+        Contig ctg;
+        memcpy(&ctg, base + offset, sizeof(Contig));
+        offset += sizeof(Contig);
+        if(ctg.mSeqOffset + ((ctg.mLen + 3) >> 2) > bytes || ctg.mNOffset + ctg.mNRuns * 2 * sizeof(uint32_t) > bytes) valid = false;
+        contigs.push_back(ctg);
+    }
+    if(!valid){
+        munmap(map, bytes);
+        return false;
+    }
+    close();
+    mFp = fp;
+    mMap = base;
+    mBytes = bytes;
+    mContigs.swap(contigs);
+    mNames.swap(names);
+    for(uint32_t i = 0; i < mNames.size(); ++i) mIdx[mNames[i]] = i;
+    return true;
+}
+
+void NGapIndex::open(const std::string& genome, const RefStore* ref){
+    // FASTA size and modification time are used to detect stale sidecar
+    struct stat info;
+    int64_t fsize = 0, mtime = 0;
+    if(stat(genome.c_str(), &info) == 0){
+        fsize = info.st_size;
+        mtime = info.st_mtime;
+    }
+    std::string path = genome + ".sver.ngap";
+    if(load(path, fsize, mtime)){
+        util::loginfo("N gaps of reference loaded from " + path);
+        return;
+    }
+    // Collect N gaps from runs of reference store
+    mGaps.assign(ref->mContigs.size(), std::vector<NGap>());
+    mIdx.clear();
+    for(uint32_t i = 0; i < ref->mContigs.size(); ++i){
+        const uint32_t* runs = ref->nRuns(i);
+        for(uint32_t k = 0; k < ref->mContigs[i].mNRuns; ++k) mGaps[i].push_back(std::make_pair(runs[2 * k], runs[2 * k + 1]));
+        mIdx[ref->mNames[i]] = i;
+    }
+    save(path, fsize, mtime);
+}
+
+bool NGapIndex::load(const std::string& path, int64_t fsize, int64_t mtime){
+    FILE* fp = fopen(path.c_str(), "rb");
+    if(!fp) return false;
+    char magic[8];
+    uint32_t version = 0, ncontig = 0;
+    int64_t size = -1, time = -1;
+    bool valid = fread(magic, 1, 8, fp) == 8 && memcmp(magic, "SVERNGAP", 8) == 0 &&
+                 fread(&version, sizeof(uint32_t), 1, fp) == 1 && version == 1 &&
+                 fread(&size, sizeof(int64_t), 1, fp) == 1 && size == fsize &&
+                 fread(&time, sizeof(int64_t), 1, fp) == 1 && time == mtime &&
+                 fread(&ncontig, sizeof(uint32_t), 1, fp) == 1;
+    std::vector<std::vector<NGap>> gaps;
+    std::unordered_map<std::string, uint32_t> idx;
+    std::vector<uint32_t> runs;
+    for(uint32_t i = 0; valid && i < ncontig; ++i){
+        uint32_t nameLen = 0, ngap = 0;
+        if(fread(&nameLen, sizeof(uint32_t), 1, fp) != 1 || nameLen > 65536){
+            valid = false;
+            break;
+        }
+        std::string name(nameLen, '\0');
+        if(fread(&name[0], 1, nameLen, fp) != nameLen || fread(&ngap, sizeof(uint32_t), 1, fp) != 1){
+            valid = false;
+            break;
+        }
+        runs.resize(2 * (size_t)ngap);
+        if(fread(runs.data(), sizeof(uint32_t), runs.size(), fp) != runs.size()){
+            valid = false;
+            break;
+        }
+        gaps.push_back(std::vector<NGap>(ngap));
+        for(uint32_t k = 0; k < ngap; ++k) gaps.back()[k] = std::make_pair(runs[2 * k], runs[2 * k + 1]);
+        idx[name] = i;
+    }
+    fclose(fp);
+    if(!valid) return false;
+    mGaps.swap(gaps);
+    mIdx.swap(idx);
+    return true;
+}
+
+void NGapIndex::save(const std::string& path, int64_t fsize, int64_t mtime){
+    // Write an temporary file first, so other runs never load an partial sidecar
+    std::string tmp = path + "." + std::to_string(getpid()) + ".tmp";
+    FILE* fp = fopen(tmp.c_str(), "wb");
+    if(!fp){
+        util::loginfo("N gap sidecar " + path + " can not be written, skip saving N gaps");
+        return;
+    }
+    std::vector<std::string> names(mGaps.size());
+    for(auto& e: mIdx) names[e.second] = e.first;
+    uint32_t version = 1, ncontig = mGaps.size();
+    fwrite("SVERNGAP", 1, 8, fp);
+    fwrite(&version, sizeof(uint32_t), 1, fp);
+    fwrite(&fsize, sizeof(int64_t), 1, fp);
+    fwrite(&mtime, sizeof(int64_t), 1, fp);
+    fwrite(&ncontig, sizeof(uint32_t), 1, fp);
+    std::vector<uint32_t> runs;
+    for(uint32_t i = 0; i < ncontig; ++i){
+        uint32_t nameLen = names[i].size(), ngap = mGaps[i].size();
+        fwrite(&nameLen, sizeof(uint32_t), 1, fp);
+        fwrite(names[i].c_str(), 1, nameLen, fp);
+        fwrite(&ngap, sizeof(uint32_t), 1, fp);
+        runs.clear();
+        for(auto& g: mGaps[i]){
+            runs.push_back(g.first);
+            runs.push_back(g.second);
+        }
+        fwrite(runs.data(), sizeof(uint32_t), runs.size(), fp);
+    }
+    bool failed = fflush(fp) != 0 || ferror(fp);
+    fclose(fp);
+    if(failed || std::rename(tmp.c_str(), path.c_str()) != 0){
+        std::remove(tmp.c_str());
+        util::loginfo("N gap sidecar " + path + " can not be written, skip saving N gaps");
+        return;
+    }
+    util::loginfo("N gaps of reference saved to " + path);
+}
@@ -0,0 +1,198 @@
+#ifndef REFSTORE_H
+#define REFSTORE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include <htslib/faidx.h>
+#include "util.h"
+
+/** class to store reference genome as 2-bit packed bases plus N runs in one binary file\n
+ * the file is converted from the faidx indexed FASTA once and memory mapped read-only afterwards,\n
+ * so all threads share one copy of reference and fetch slices without parsing FASTA again\n
+ * file layout: [header][packed bases and N runs of each contig][contig index]\n
+ * bases are packed 4 per byte from the lowest bits(A:0, C:1, G:2, T:3), all other bases are stored as N runs
+ */
+class RefStore{
+    public:
+        /** one contig in store */
+        struct Contig{
+            uint32_t mLen;        ///< contig length
+            uint64_t mSeqOffset;  ///< offset of packed bases in file
+            uint64_t mNOffset;    ///< offset of N runs in file, each run stored as <start, end(exclusive)> in uint32_t
+            uint32_t mNRuns;      ///< number of N runs
+        };
+
+        /** file header */
+        struct Header{
+            char mMagic[8];        ///< file magic "SVER2BIT"
+            uint32_t mVersion;     ///< file format version
+            uint32_t mContigNum;   ///< number of contigs
+            int64_t mFastaSize;    ///< size of FASTA converted from
+            int64_t mFastaMtime;   ///< modification time of FASTA converted from
+            uint64_t mIndexOffset; ///< offset of contig index in file
+        };
+
+        FILE* mFp;                                       ///< file handle of store
+        const uint8_t* mMap;                             ///< mapped file
+        size_t mBytes;                                   ///< bytes of mapped file
+        std::vector<Contig> mContigs;                    ///< contigs in store
+        std::vector<std::string> mNames;                 ///< name of each contig
+        std::unordered_map<std::string, uint32_t> mIdx;  ///< index of each contig by name
+
+    public:
+        /** RefStore constructor */
+        RefStore(){
+            mFp = NULL;
+            mMap = NULL;
+            mBytes = 0;
+        }
+
+        /** RefStore destructor */
+        ~RefStore(){
+            close();
+        }
+
+        /** open store of an genome, the store <genome>.sver.2bit is converted from FASTA if missing or stale\n
+         * store is converted into an temporary file if <genome>.sver.2bit can not be written
+         * @param genome path of faidx indexed FASTA
+         */
+        void open(const std::string& genome);
+
+        /** release mapped file */
+        void close();
+
+        /** get length of an contig
+         * @param chr name of contig
+         * @return length of contig
+         */
+        inline int32_t length(const char* chr) const {
+            return mContigs[contigIndex(chr)].mLen;
+        }
+
+        /** get N runs of an contig
+         * @param i index of contig in mContigs
+         * @return N runs stored as <start, end(exclusive)> pairs, mContigs[i].mNRuns pairs in total
+         */
+        inline const uint32_t* nRuns(uint32_t i) const {
+            return (const uint32_t*)(mMap + mContigs[i].mNOffset);
+        }
+
+        /** fetch upper case bases of an contig in [beg, end), range is clipped to contig
+         * @param chr name of contig
+         * @param beg starting position of slice(0-based)
+         * @param end ending position of slice(exclusive)
+         * @param seq string to store bases
+         */
+        void slice(const char* chr, int32_t beg, int32_t end, std::string& seq) const;
+
+        /** fetch upper case bases of an contig in [beg, end), range is clipped to contig
+         * @param chr name of contig
+         * @param beg starting position of slice(0-based)
+         * @param end ending position of slice(exclusive)
+         * @return bases of slice
+         */
+        inline std::string slice(const char* chr, int32_t beg, int32_t end) const {
+            std::string seq;
+            slice(chr, beg, end, seq);
+            return seq;
+        }
+
+    private:
+        /** get index of an contig, exit if not found
+         * @param chr name of contig
+         * @return index of contig in mContigs
+         */
+        inline uint32_t contigIndex(const char* chr) const {
+            auto it = mIdx.find(chr);
+            if(it == mIdx.end()) util::errorExit("Contig " + std::string(chr) + " not found in reference");
+            return it->second;
+        }
+
+        /** convert an faidx indexed FASTA into store
+         * @param genome path of FASTA
+         * @param fp file handle to write store to
+         * @param fsize size of FASTA
+         * @param mtime modification time of FASTA
+         */
+        static void build(const std::string& genome, FILE* fp, int64_t fsize, int64_t mtime);
+
+        /** map an store file and load its contig index
+         * @param fp file handle of store
+         * @param fsize size of FASTA expected
+         * @param mtime modification time of FASTA expected
+         * @return true if store is valid and matches FASTA
+         */
+        bool load(FILE* fp, int64_t fsize, int64_t mtime);
+};
+
+typedef std::pair<int32_t, int32_t> NGap; ///< <start, end(exclusive)> of an N gap
+
+/** class to store sorted N gaps of reference genome, loaded from sidecar file <genome>.sver.ngap\n
+ * the sidecar is written from N runs of RefStore once if missing or stale, so no base is scanned per run\n
+ * file layout: [magic "SVERNGAP"][version][FASTA size][FASTA mtime][contigs]{[name length][name][gaps][<start, end> of each gap]}
+ */
+class NGapIndex{
+    public:
+        std::vector<std::vector<NGap>> mGaps;            ///< sorted N gaps of each contig
+        std::unordered_map<std::string, uint32_t> mIdx;  ///< index of each contig by name
+
+    public:
+        /** NGapIndex constructor */
+        NGapIndex(){}
+
+        /** NGapIndex destructor */
+        ~NGapIndex(){}
+
+        /** load N gaps of an genome, the sidecar is written from ref if missing or stale
+         * @param genome path of FASTA
+         * @param ref pointer to RefStore of genome
+         */
+        void open(const std::string& genome, const RefStore* ref);
+
+        /** get N gaps of an contig
+         * @param chr name of contig
+         * @return sorted N gaps of contig, empty if contig has none
+         */
+        inline const std::vector<NGap>& gaps(const char* chr) const {
+            static const std::vector<NGap> none;
+            auto it = mIdx.find(chr);
+            if(it == mIdx.end()) return none;
+            return mGaps[it->second];
+        }
+
+        /** find the first N gap overlapping an region by binary search
+         * @param gaps sorted N gaps of one contig
+         * @param beg starting position of region
+         * @param end ending position of region(exclusive)
+         * @return pointer to the first gap overlapping [beg, end), NULL if none
+         */
+        inline static const NGap* firstOverlap(const std::vector<NGap>& gaps, int32_t beg, int32_t end){
+            auto it = std::upper_bound(gaps.begin(), gaps.end(), beg, [](int32_t pos, const NGap& g){return pos < g.second;});
+            if(it == gaps.end() || it->first >= end || beg >= end) return NULL;
+            return &(*it);
+        }
+
+    private:
+        /** load sidecar file
+         * @param path path of sidecar
+         * @param fsize size of FASTA expected
+         * @param mtime modification time of FASTA expected
+         * @return true if sidecar is valid and matches FASTA
+         */
+        bool load(const std::string& path, int64_t fsize, int64_t mtime);
+
+        /** save N gaps into sidecar file
+         * @param path path of sidecar
+         * @param fsize size of FASTA
+         * @param mtime modification time of FASTA
+         */
+        void save(const std::string& path, int64_t fsize, int64_t mtime);
+};
+
+#endif
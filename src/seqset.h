@@ -0,0 +1,114 @@
+#ifndef SEQSET_H
+#define SEQSET_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+/** class to store unique sequences with their multiplicity\n
+ * bases of all sequences are appended to one arena, sequences are sorted and duplicates merged by finish()\n
+ * so identical reads are stored once and weighted by count instead of aligned repeatedly
+ */
+class SeqSet{
+    public:
+        std::string mArena;            ///< bases of all sequences added
+        std::vector<uint32_t> mOffset; ///< offset of each unique sequence in mArena
+        std::vector<int32_t> mLen;     ///< length of each unique sequence
+        std::vector<int32_t> mCount;   ///< multiplicity of each unique sequence
+        int32_t mTotal;                ///< number of sequences added
+
+    public:
+        /** SeqSet constructor */
+        SeqSet(){
+            mTotal = 0;
+        }
+
+        /** SeqSet destructor */
+        ~SeqSet(){}
+
+        /** add an sequence, finish() must be called after all sequences added
+         * @param seq sequence to add
+         */
+        inline void add(const std::string& seq){
+            mOffset.push_back(mArena.size());
+            mLen.push_back(seq.size());
+            mCount.push_back(1);
+            mArena.append(seq);
+            ++mTotal;
+        }
+
+        /** sort sequences added and merge duplicates into one weighted sequence */
+        inline void finish(){
+            std::vector<uint32_t> order(mOffset.size());
+            for(uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b){return compare(a, b) < 0;});
+            std::vector<uint32_t> offset;
+            std::vector<int32_t> len, count;
+            for(auto& i: order){
+                if(!offset.empty() && len.back() == mLen[i] && memcmp(&mArena[offset.back()], &mArena[mOffset[i]], mLen[i]) == 0){
+                    count.back() += mCount[i];
+                    continue;
+                }
+                offset.push_back(mOffset[i]);
+                len.push_back(mLen[i]);
+                count.push_back(mCount[i]);
+            }
+            mOffset.swap(offset);
+            mLen.swap(len);
+            mCount.swap(count);
+        }
+
+        /** get number of unique sequences
+         * @return number of unique sequences
+         */
+        inline int32_t size() const {
+            return mOffset.size();
+        }
+
+        /** get number of sequences added, duplicates included
+         * @return number of sequences added
+         */
+        inline int32_t total() const {
+            return mTotal;
+        }
+
+        /** get bases of an unique sequence
+         * @param i index of sequence
+         * @return pointer to bases of sequence, not NUL terminated
+         */
+        inline const char* seq(int32_t i) const {
+            return mArena.data() + mOffset[i];
+        }
+
+        /** get length of an unique sequence
+         * @param i index of sequence
+         * @return length of sequence
+         */
+        inline int32_t length(int32_t i) const {
+            return mLen[i];
+        }
+
+        /** get multiplicity of an unique sequence
+         * @param i index of sequence
+         * @return number of times the sequence added
+         */
+        inline int32_t count(int32_t i) const {
+            return mCount[i];
+        }
+
+    private:
+        /** compare two sequences lexicographically, same order as std::string
+         * @param a index of the first sequence
+         * @param b index of the second sequence
+         * @return negative if a < b, 0 if equal, positive otherwise
+         */
+        inline int compare(uint32_t a, uint32_t b) const {
+            int r = memcmp(&mArena[mOffset[a]], &mArena[mOffset[b]], std::min(mLen[a], mLen[b]));
+            if(r) return r;
+            return mLen[a] - mLen[b];
+        }
+};
+
+#endif
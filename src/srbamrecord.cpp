@@ -1,415 +1,393 @@
 #include "srbamrecord.h"
+#include "ThreadPool.h"
 
 void SRBamRecordSet::classifyJunctions(JunctionMap* jctMap){
     util::loginfo("Start classifing SRs into various SV candidates");
     if(!jctMap->mSorted) jctMap->sortJunctions();
+    for(size_t beg = 0, end = 0; beg < jctMap->mJunctions.size(); beg = end){
+        end = jctMap->readEnd(beg);
+        classifyRead(&jctMap->mJunctions[beg], end - beg);
+    }
+    util::loginfo("Finish classifing SRs into various SV candidates");
+}
+
+void SRBamRecordSet::classifyRead(const Junction* jcts, uint32_t n){
+    // Skip split read which has only one part mapped
+    if(n < 2) return;
     int svtIdx = 0;
-    int32_t rst = -1;
-    for(auto iter = jctMap->mJunctionReads.begin(); iter != jctMap->mJunctionReads.end(); ++iter){
-        // Skip split read which has only one part mapped
-        if(iter->second.size() < 2) continue;
-        for(uint32_t i = 0; i < iter->second.size(); ++i){
-            for(uint32_t j = i + 1; j < iter->second.size(); ++j){
-                // get read starting mapping position
-                rst = iter->second[i].mRstart;
-                if(rst == -1) rst = iter->second[j].mRstart;
-                // check possible translocation split read
-                if(iter->second[j].mRefidx != iter->second[i].mRefidx){
-                    // skip two split parts which have abnormal starting split position in read(5'->3')
-                    if(iter->second[j].mSeqpos - iter->second[i].mSeqpos > mOpt->filterOpt->mMaxReadSep) break;
-                    int32_t littleChrIdx = i;
-                    int32_t largerChrIdx = j;
-                    if(iter->second[j].mRefidx < iter->second[i].mRefidx){
-                        littleChrIdx = j;
-                        largerChrIdx = i;
-                    }
-                    svtIdx = 0;
-                    if(iter->second[littleChrIdx].mForward == iter->second[largerChrIdx].mForward){
-                        // Same direction, opposing soft-clips
-                        if(iter->second[littleChrIdx].mSCleft != iter->second[largerChrIdx].mSCleft){
-                            if(iter->second[littleChrIdx].mSCleft){
-                                svtIdx = 7; // littleChr on 3' part
-                            }else{
-                                svtIdx = 8; // littleChr on 5' part
-                            }
+    int32_t ridx = -1;
+    for(uint32_t i = 0; i < n; ++i){
+        for(uint32_t j = i + 1; j < n; ++j){
+            // get captured read of the primary part
+            ridx = jcts[i].mPrimary ? jcts[i].mReadIdx : jcts[j].mReadIdx;
+            // check possible translocation split read
+            if(jcts[j].mRefidx != jcts[i].mRefidx){
+                // skip two split parts which have abnormal starting split position in read(5'->3')
+                if(jcts[j].mSeqpos - jcts[i].mSeqpos > mOpt->filterOpt->mMaxReadSep) break;
+                int32_t littleChrIdx = i;
+                int32_t largerChrIdx = j;
+                if(jcts[j].mRefidx < jcts[i].mRefidx){
+                    littleChrIdx = j;
+                    largerChrIdx = i;
+                }
+                svtIdx = 0;
+                if(jcts[littleChrIdx].mForward == jcts[largerChrIdx].mForward){
+                    // Same direction, opposing soft-clips
+                    if(jcts[littleChrIdx].mSCleft != jcts[largerChrIdx].mSCleft){
+                        if(jcts[littleChrIdx].mSCleft){
+                            svtIdx = 7; // littleChr on 3' part
+                        }else{
+                            svtIdx = 8; // littleChr on 5' part
                         }
-                    }else{
-                        //opposing direction, same doft-clips
-                        if(iter->second[littleChrIdx].mSCleft == iter->second[largerChrIdx].mSCleft){
-                            if(iter->second[littleChrIdx].mSCleft){
-                                svtIdx = 6; // 3to3 connection
-                            }else{
-                                svtIdx = 5; // 5to5 connection
-                            }
+                    }
+                }else{
+                    //opposing direction, same doft-clips
+                    if(jcts[littleChrIdx].mSCleft == jcts[largerChrIdx].mSCleft){
+                        if(jcts[littleChrIdx].mSCleft){
+                            svtIdx = 6; // 3to3 connection
+                        }else{
+                            svtIdx = 5; // 5to5 connection
                         }
                     }
-                    if(svtIdx && mOpt->SVTSet.find(svtIdx) != mOpt->SVTSet.end()){
-                        mSRs[svtIdx].push_back(SRBamRecord(iter->second[largerChrIdx].mRefidx,
-                                                        iter->second[largerChrIdx].mRefpos,
-                                                        iter->second[littleChrIdx].mRefidx,
-                                                        iter->second[littleChrIdx].mRefpos,
-                                                        rst,
-                                                        std::abs(iter->second[j].mSeqpos - iter->second[i].mSeqpos),
-                                                        iter->first));
+                }
+                if(svtIdx && mOpt->SVTSet.find(svtIdx) != mOpt->SVTSet.end()){
+                    mSRs[svtIdx].push_back(SRBamRecord(jcts[largerChrIdx].mRefidx,
+                                                    jcts[largerChrIdx].mRefpos,
+                                                    jcts[littleChrIdx].mRefidx,
+                                                    jcts[littleChrIdx].mRefpos,
+                                                    std::abs(jcts[j].mSeqpos - jcts[i].mSeqpos),
+                                                    ridx));
+                }
+            }else{
+                svtIdx = -1;
+                int32_t leftPart = i;
+                int32_t rightPart = j;
+                if(jcts[j].mRefpos <= jcts[i].mRefpos){
+                    leftPart = j;
+                    rightPart = i;
+                }
+                // check possible insertion split read
+                if(jcts[j].mSeqpos - jcts[i].mSeqpos > mOpt->filterOpt->mMaxReadSep){
+                    // Same chr, same direction, opposing soft-clips
+                    if(jcts[j].mForward == jcts[i].mForward && 
+                       jcts[j].mSCleft != jcts[i].mSCleft  && 
+                       std::abs(jcts[j].mRefpos - jcts[i].mRefpos) < mOpt->filterOpt->mMaxReadSep){
+                        svtIdx = 4;
                     }
                 }else{
-                    svtIdx = -1;
-                    int32_t leftPart = i;
-                    int32_t rightPart = j;
-                    if(iter->second[j].mRefpos <= iter->second[i].mRefpos){
-                        leftPart = j;
-                        rightPart = i;
-                    }
-                    // check possible insertion split read
-                    if(iter->second[j].mSeqpos - iter->second[i].mSeqpos > mOpt->filterOpt->mMaxReadSep){
-                        // Same chr, same direction, opposing soft-clips
-                        if(iter->second[j].mForward == iter->second[i].mForward && 
-                           iter->second[j].mSCleft != iter->second[i].mSCleft  && 
-                           std::abs(iter->second[j].mRefpos - iter->second[i].mRefpos) < mOpt->filterOpt->mMaxReadSep){
-                            svtIdx = 4;
+                    // Same chr, same direction, opposing soft-clips
+                    if(jcts[j].mForward == jcts[i].mForward && 
+                       jcts[j].mSCleft != jcts[i].mSCleft &&
+                       std::abs(jcts[j].mRefpos - jcts[i].mRefpos) >= mOpt->filterOpt->mMinRefSep){
+                        if(jcts[leftPart].mSCleft){
+                            svtIdx = 3; // left part leading soft-clip, duplication
+                        }else{
+                            svtIdx = 2; // left part tailing soft-clip, deletion
                         }
-                    }else{
-                        // Same chr, same direction, opposing soft-clips
-                        if(iter->second[j].mForward == iter->second[i].mForward && 
-                           iter->second[j].mSCleft != iter->second[i].mSCleft &&
-                           std::abs(iter->second[j].mRefpos - iter->second[i].mRefpos) >= mOpt->filterOpt->mMinRefSep){
-                            if(iter->second[leftPart].mSCleft){
-                                svtIdx = 3; // left part leading soft-clip, duplication
-                            }else{
-                                svtIdx = 2; // left part tailing soft-clip, deletion
-                            }
-                        // Same chr, opposing direction, same soft-clips
-                        }else if(iter->second[j].mForward != iter->second[i].mForward &&
-                                 iter->second[j].mSCleft == iter->second[i].mSCleft &&
-                                 std::abs(iter->second[j].mRefpos - iter->second[i].mRefpos) >= mOpt->filterOpt->mMinRefSep){
-                            if(iter->second[j].mSCleft){
-                                svtIdx = 1; // 3to3 right spanning inversion breakpoint
-                            }else{
-                                svtIdx = 0; // 5to5 left spanning inversion breakpoint
-                            }
+                    // Same chr, opposing direction, same soft-clips
+                    }else if(jcts[j].mForward != jcts[i].mForward &&
+                             jcts[j].mSCleft == jcts[i].mSCleft &&
+                             std::abs(jcts[j].mRefpos - jcts[i].mRefpos) >= mOpt->filterOpt->mMinRefSep){
+                        if(jcts[j].mSCleft){
+                            svtIdx = 1; // 3to3 right spanning inversion breakpoint
+                        }else{
+                            svtIdx = 0; // 5to5 left spanning inversion breakpoint
                         }
                     }
-                    if(svtIdx != -1 && mOpt->SVTSet.find(svtIdx) != mOpt->SVTSet.end()){
-                        mSRs[svtIdx].push_back(SRBamRecord(iter->second[leftPart].mRefidx,
-                                                        iter->second[leftPart].mRefpos,
-                                                        iter->second[rightPart].mRefidx,
-                                                        iter->second[rightPart].mRefpos,
-                                                        rst,
-                                                        std::abs(iter->second[j].mSeqpos - iter->second[i].mSeqpos),
-                                                        iter->first));
-                    }
+                }
+                if(svtIdx != -1 && mOpt->SVTSet.find(svtIdx) != mOpt->SVTSet.end()){
+                    mSRs[svtIdx].push_back(SRBamRecord(jcts[leftPart].mRefidx,
+                                                    jcts[leftPart].mRefpos,
+                                                    jcts[rightPart].mRefidx,
+                                                    jcts[rightPart].mRefpos,
+                                                    std::abs(jcts[j].mSeqpos - jcts[i].mSeqpos),
+                                                    ridx));
                 }
             }
         }
     }
-    util::loginfo("Finish classifing SRs into various SV candidates");
 }
 
-void SRBamRecordSet::cluster(std::vector<SRBamRecord>& srs, SVSet& svs, int32_t svt){
-    util::loginfo("Start clustering SRs for SV type:" + std::to_string(svt));
-    for(auto&refIdx : mOpt->svRefID){
-        // Components assigned marker
-        std::vector<int32_t> comp = std::vector<int32_t>(srs.size(), 0);
-        int32_t compNum = 0;
-        Cluster compEdge; // component clusters
-        // Construct graphs
-        size_t lastConnectedNodesEnd = 0;
-        size_t lastConnectedNodesBeg = 0;
-        for(uint32_t i = 0; i < srs.size(); ++i){
-            if(srs[i].mChr1 != refIdx) continue;
-            // Safe to clean the graph ?
-            if(i > lastConnectedNodesEnd){
-                // Clean edge lists
-                if(!compEdge.empty()){
-                    searchCliques(compEdge, srs, svs, svt);
-                    lastConnectedNodesBeg = lastConnectedNodesEnd;
-                    compEdge.clear();
-                }
+void SRBamRecordSet::clusterPartition(std::vector<SRBamRecord>* srs, size_t beg, size_t end, SVSet* svs, int32_t svt){
+    // Subsample hyper-dense regions so clustering cost of pathological loci is bounded
+    std::vector<DenseRegion> dense;
+    int32_t chr1 = (*srs)[beg].chr1();
+    end = DenseSampler::subsample(*srs, beg, end, [](const SRBamRecord& sr){return sr.pos1();}, mOpt->filterOpt->mMaxReadSep,
+                                  mOpt->filterOpt->mMaxEvidenceDensity, ((uint64_t)svt << 32) | chr1, dense);
+    for(auto& dr : dense){
+        util::loginfo("Dense SR region of SV type " + std::to_string(svt) + " at " + std::to_string(chr1) + ":" + std::to_string(dr.mBeg) + "-" + std::to_string(dr.mEnd) +
+                      " subsampled, " + std::to_string(dr.mDropped) + " of " + std::to_string(dr.mRecords) + " SRs dropped", mOpt->logMtx);
+    }
+    // Components assigned marker
+    std::vector<int32_t> comp(end - beg, 0);
+    UnionFind uf;
+    // Edge list of each component, lists are reused once their components searched
+    std::vector<std::vector<EdgeRecord>> edgeLists;
+    std::vector<int32_t> compList(1, -1); // index in edgeLists of each component, -1 if merged into another component
+    size_t usedLists = 0;
+    CliqueScratch scratch;
+    auto searchComponents = [&](){
+        for(uint32_t k = 1; k < compList.size(); ++k){
+            if(compList[k] >= 0) searchCliques(edgeLists[compList[k]], *srs, *svs, svt, scratch);
+        }
+        compList.resize(1);
+        usedLists = 0;
+        uf.clear();
+    };
+    // Construct graphs
+    size_t lastConnectedNodesEnd = beg;
+    for(size_t i = beg; i < end; ++i){
+        // Safe to clean the graph ?
+        if(i > lastConnectedNodesEnd && compList.size() > 1) searchComponents();
+        // Search possible connectable node
+        for(size_t j = i + 1; j < end; ++j){
+            if((*srs)[j].pos1() - (*srs)[i].pos1() > mOpt->filterOpt->mMaxReadSep) break; // mapping position in valid range
+            // Update last connected node
+            if(j > lastConnectedNodesEnd) lastConnectedNodesEnd = j;
+            // Assign components
+            int32_t compI = comp[i - beg] ? uf.find(comp[i - beg]) : 0;
+            int32_t compJ = comp[j - beg] ? uf.find(comp[j - beg]) : 0;
+            int32_t compIndex = 0;
+            if(!compI && !compJ){// Neither vertex has component assigned
+                compIndex = uf.add();
+                comp[i - beg] = compIndex;
+                comp[j - beg] = compIndex;
+                if(usedLists == edgeLists.size()) edgeLists.emplace_back();
+                edgeLists[usedLists].clear();
+                compList.push_back(usedLists++);
+            }else if(!compI){// Only one vertex has component assigned
+                compIndex = compJ;
+                comp[i - beg] = compIndex;
+            }else if(!compJ){// Only one vertex has component assigned
+                compIndex = compI;
+                comp[j - beg] = compIndex;
+            }else if(compI == compJ){
+                compIndex = compI;
+            }else{// Both vertices have components assigned, then merge these components
+                compIndex = uf.unite(compI, compJ);
+                int32_t otherIndex = compI + compJ - compIndex;
+                // Merge edge list
+                std::vector<EdgeRecord>& compEdges = edgeLists[compList[compIndex]];
+                std::vector<EdgeRecord>& otherEdges = edgeLists[compList[otherIndex]];
+                compEdges.insert(compEdges.end(), otherEdges.begin(), otherEdges.end());
+                compList[otherIndex] = -1;
             }
-            // Search possible connectable node
-            for(uint32_t j = i + 1; j < srs.size(); ++j){
-                if(srs[j].mChr1 != refIdx) continue; // same chr
-                if(srs[j].mPos1 - srs[i].mPos1 > mOpt->filterOpt->mMaxReadSep) break; // mapping position in valid range
-                // Update last connected node
-                if(j > lastConnectedNodesEnd) lastConnectedNodesEnd = j;
-                // Assign components
-                int32_t compIndex = 0;
-                if(!comp[i]){
-                    if(!comp[j]){// Neither vertex has component assigned
-                        compIndex = ++compNum;
-                        comp[i] = compIndex;
-                        comp[j] = compIndex;
-                        compEdge.insert(std::make_pair(compIndex, std::vector<EdgeRecord>()));
-                    }else{// Only one vertex has component assigned
-                        compIndex = comp[j];
-                        comp[i] = compIndex;
-                    }
-                }else{
-                    if(!comp[j]){// Only one vertex has component assigned
-                        compIndex = comp[i];
-                        comp[j] = compIndex;
-                    }else{// Both vertices have components assigned, then merge these components
-                        if(comp[i] == comp[j]) compIndex = comp[i];
-                        else{// Merge components
-                            compIndex = comp[i];
-                            int32_t otherIndex = comp[j];
-                            if(otherIndex < compIndex){
-                                compIndex = comp[j];
-                                otherIndex = comp[i];
-                            }
-                            // Re-label other index
-                            for(uint32_t k = lastConnectedNodesBeg; k <= lastConnectedNodesEnd; ++k){
-                                if(otherIndex == comp[k]){
-                                    comp[k] = compIndex;
-                                }
-                            }
-                            // Merge edge list
-                            auto compIdxIter = compEdge.find(compIndex);
-                            auto otherIdxIter = compEdge.find(otherIndex);
-                            compIdxIter->second.insert(compIdxIter->second.end(), otherIdxIter->second.begin(), otherIdxIter->second.end());
-                            compEdge.erase(otherIdxIter);
-                        }
-                    }
-                }
-                // Append new edge
-                auto compEdgeIter = compEdge.find(compIndex);
-                if(compEdgeIter->second.size() < mOpt->filterOpt->mGraphPruning){
-                    // Breakpoint distance
-                    int32_t weight = std::abs(srs[j].mPos2 - srs[i].mPos2) + std::abs(srs[j].mPos1 - srs[i].mPos1);
-                    compEdgeIter->second.push_back(EdgeRecord(i, j, weight));
-                }
+            // Append new edge
+            std::vector<EdgeRecord>& edges = edgeLists[compList[compIndex]];
+            if(edges.size() < mOpt->filterOpt->mGraphPruning){
+                // Breakpoint distance
+                int32_t weight = std::abs((*srs)[j].mPos2 - (*srs)[i].mPos2) + std::abs((*srs)[j].pos1() - (*srs)[i].pos1());
+                edges.push_back(EdgeRecord(i, j, weight));
             }
         }
-        // Search cliques
-        if(!compEdge.empty()){
-            searchCliques(compEdge, srs, svs, svt);
-            compEdge.clear();
-        }
     }
-    util::loginfo("Finish clustering SRs for SV type:" + std::to_string(svt));
+    // Search cliques
+    if(compList.size() > 1) searchComponents();
 }
 
-void SRBamRecordSet::searchCliques(Cluster& compEdge, std::vector<SRBamRecord>& srs, SVSet& svs, int32_t svt){
-    // Iterate all components
-    for(auto compIter = compEdge.begin(); compIter != compEdge.end(); ++compIter){
-        // Sort edges by weight
-        std::sort(compIter->second.begin(), compIter->second.end());
-        auto edgeIter = compIter->second.begin();
-        // Find a large clique
-        std::set<int32_t> clique, incompatible;
-        // Initialization clique
-        clique.insert(edgeIter->mSource);
-        int32_t chr1 = srs[edgeIter->mSource].mChr1;
-        int32_t chr2 = srs[edgeIter->mSource].mChr2;
-        int32_t ciposlow = srs[edgeIter->mSource].mPos1;
-        uint64_t pos1 = srs[edgeIter->mSource].mPos1;
-        int32_t ciposhigh = srs[edgeIter->mSource].mPos1;
-        int32_t ciendlow = srs[edgeIter->mSource].mPos2;
-        uint64_t pos2 = srs[edgeIter->mSource].mPos2;
-        int32_t ciendhigh = srs[edgeIter->mSource].mPos2;
-        int32_t inslen = srs[edgeIter->mSource].mInslen;
-        ++edgeIter;
-        // Grow clique
-        for(; edgeIter != compIter->second.end(); ++edgeIter){
-            // Find next best edge for extension
-            int32_t v;
-            if(clique.find(edgeIter->mSource) == clique.end() && clique.find(edgeIter->mTarget) != clique.end()){
-                v = edgeIter->mSource;
-            }else if(clique.find(edgeIter->mSource) != clique.end() && clique.find(edgeIter->mTarget) == clique.end()){
-                v = edgeIter->mTarget;
-            }else continue;
-            if(incompatible.find(v) != incompatible.end()) continue;
-            // Try to update clique with this vertex
-            int32_t newCiPosLow = std::min(srs[v].mPos1, ciposlow);
-            int32_t newCiPosHigh = std::max(srs[v].mPos1, ciposhigh);
-            int32_t newCiEndLow = std::min(srs[v].mPos2, ciendlow);
-            int32_t newCiEndHigh = std::max(srs[v].mPos2, ciendhigh);
-            if((newCiPosHigh - newCiPosLow) < mOpt->filterOpt->mMaxReadSep &&
-               (newCiEndHigh - newCiEndLow) < mOpt->filterOpt->mMaxReadSep){// Accept new vertex
-                clique.insert(v);
-                ciposlow = newCiPosLow;
-                pos1 += srs[v].mPos1;
-                ciposhigh = newCiPosHigh;
-                ciendlow = newCiEndLow;
-                pos2 += srs[v].mPos2;
-                ciendhigh = newCiEndHigh;
-                inslen += srs[v].mInslen;
-              }else incompatible.insert(v);
-        }
-        // At least 2 split read support
-        if(clique.size() > 1){
-            int32_t svStart = pos1/clique.size();
-            int32_t svEnd = pos2/clique.size();
-            int32_t svISize = inslen/clique.size();
-            int32_t svid = svs.size();
-            SVRecord svr;
-            svr.mChr1 = chr1;
-            svr.mSVStart = svStart;
-            svr.mChr2 = chr2;
-            svr.mSVEnd = svEnd;
-            svr.mCiPosLow = ciposlow - svStart;
-            svr.mCiPosHigh = ciposhigh - svStart;
-            svr.mCiEndLow = ciendlow - svEnd;
-            svr.mCiEndHigh = ciendhigh - svEnd;
-            svr.mInsLen = svISize;
-            svr.mID = svid;
-            svr.mSVT = svt;
-            svs.push_back(svr);
-            // Reads assigned
-            for(auto& e : clique) srs[e].mSVID = svid;
+void SRBamRecordSet::searchCliques(const std::vector<EdgeRecord>& edges, std::vector<SRBamRecord>& srs, SVSet& svs, int32_t svt, CliqueScratch& scratch){
+    if(edges.empty()) return;
+    // Sort edges by weight
+    scratch.sortEdges(edges);
+    // Vertices are given local ids from the smallest vertex of component
+    int32_t base = edges[0].mSource;
+    int32_t last = edges[0].mTarget;
+    for(auto& e : edges){
+        base = std::min(base, e.mSource);
+        last = std::max(last, e.mTarget);
+    }
+    scratch.reset(last - base + 1);
+    auto edgeIter = scratch.mEdges.begin();
+    // Find a large clique
+    uint32_t cliqueSize = 1;
+    // Initialization clique
+    scratch.addClique(edgeIter->mSource - base);
+    int32_t chr1 = srs[edgeIter->mSource].chr1();
+    int32_t chr2 = srs[edgeIter->mSource].chr2();
+    int32_t ciposlow = srs[edgeIter->mSource].pos1();
+    uint64_t pos1 = srs[edgeIter->mSource].pos1();
+    int32_t ciposhigh = srs[edgeIter->mSource].pos1();
+    int32_t ciendlow = srs[edgeIter->mSource].mPos2;
+    uint64_t pos2 = srs[edgeIter->mSource].mPos2;
+    int32_t ciendhigh = srs[edgeIter->mSource].mPos2;
+    int32_t inslen = srs[edgeIter->mSource].mInslen;
+    ++edgeIter;
+    // Grow clique
+    for(; edgeIter != scratch.mEdges.end(); ++edgeIter){
+        // Find next best edge for extension
+        int32_t v;
+        bool srcIn = scratch.inClique(edgeIter->mSource - base);
+        bool tgtIn = scratch.inClique(edgeIter->mTarget - base);
+        if(!srcIn && tgtIn){
+            v = edgeIter->mSource;
+        }else if(srcIn && !tgtIn){
+            v = edgeIter->mTarget;
+        }else continue;
+        if(scratch.incompatible(v - base)) continue;
+        // Try to update clique with this vertex
+        int32_t newCiPosLow = std::min(srs[v].pos1(), ciposlow);
+        int32_t newCiPosHigh = std::max(srs[v].pos1(), ciposhigh);
+        int32_t newCiEndLow = std::min(srs[v].mPos2, ciendlow);
+        int32_t newCiEndHigh = std::max(srs[v].mPos2, ciendhigh);
+        if((newCiPosHigh - newCiPosLow) < mOpt->filterOpt->mMaxReadSep &&
+           (newCiEndHigh - newCiEndLow) < mOpt->filterOpt->mMaxReadSep){// Accept new vertex
+            scratch.addClique(v - base);
+            ++cliqueSize;
+            ciposlow = newCiPosLow;
+            pos1 += srs[v].pos1();
+            ciposhigh = newCiPosHigh;
+            ciendlow = newCiEndLow;
+            pos2 += srs[v].mPos2;
+            ciendhigh = newCiEndHigh;
+            inslen += srs[v].mInslen;
+        }else scratch.addIncompatible(v - base);
+    }
+    // At least 2 split read support
+    if(cliqueSize > 1){
+        int32_t svStart = pos1/cliqueSize;
+        int32_t svEnd = pos2/cliqueSize;
+        int32_t svISize = inslen/cliqueSize;
+        int32_t svid = svs.size();
+        SVRecord svr;
+        svr.mChr1 = chr1;
+        svr.mSVStart = svStart;
+        svr.mChr2 = chr2;
+        svr.mSVEnd = svEnd;
+        svr.mCiPosLow = ciposlow - svStart;
+        svr.mCiPosHigh = ciposhigh - svStart;
+        svr.mCiEndLow = ciendlow - svEnd;
+        svr.mCiEndHigh = ciendhigh - svEnd;
+        svr.mInsLen = svISize;
+        svr.mID = svid;
+        svr.mSVT = svt;
+        svs.push_back(svr);
+        // Reads assigned
+        for(int32_t v = base; v <= last; ++v){
+            if(scratch.inClique(v - base)) srs[v].mSVID = svid;
         }
     }
 }
 
 void SRBamRecordSet::cluster(SVSet& svs){
     if(!mSorted) sortSRs();
+    // Partition SRs of each SV type by chr1 with binary search, SRs are sorted by chr1 first
+    std::vector<int32_t> partSVT;
+    std::vector<std::pair<size_t, size_t>> partRange;
+    auto keyLess = [](const SRBamRecord& sr, uint64_t key){return sr.mKey < key;};
     for(auto& svt : mOpt->SVTSet){
-        cluster(mSRs[svt], svs, svt);
+        std::vector<SRBamRecord>& srs = mSRs[svt];
+        for(auto& refIdx : mOpt->svRefID){
+            auto lo = std::lower_bound(srs.begin(), srs.end(), (uint64_t)refIdx << 48, keyLess);
+            auto hi = std::lower_bound(lo, srs.end(), (uint64_t)(refIdx + 1) << 48, keyLess);
+            if(hi - lo < 2) continue; // at least 2 split read support
+            partSVT.push_back(svt);
+            partRange.push_back(std::make_pair(lo - srs.begin(), hi - srs.begin()));
+        }
+    }
+    util::loginfo("SR partitions to cluster: " + std::to_string(partSVT.size()));
+    // Cluster partitions in parallel
+    std::vector<SVSet> partSVs(partSVT.size());
+    ThreadPool::ThreadPool pool(std::max(1, std::min(mOpt->nthread, (int32_t)partSVT.size())));
+    std::vector<std::future<void>> rets;
+    for(uint32_t k = 0; k < partSVT.size(); ++k){
+        rets.push_back(pool.enqueue(&SRBamRecordSet::clusterPartition, this, &mSRs[partSVT[k]], partRange[k].first, partRange[k].second, &partSVs[k], partSVT[k]));
+    }
+    for(auto& e : rets) e.get();
+    // Assign SV IDs in partition order, so the result is irrelevant to threads used
+    for(uint32_t k = 0; k < partSVT.size(); ++k){
+        int32_t offset = svs.size();
+        for(auto& svr : partSVs[k]){
+            svr.mID += offset;
+            svs.push_back(svr);
+        }
+        std::vector<SRBamRecord>& srs = mSRs[partSVT[k]];
+        for(size_t i = partRange[k].first; i < partRange[k].second; ++i){
+            if(srs[i].mSVID >= 0) srs[i].mSVID += offset;
+        }
+    }
+    // Keep only reads used to assemble SVs, at most mMaxReadPerSV of each SV
+    if(mReadStore){
+        std::vector<std::vector<int32_t>> svReads;
+        getSVReads(svs.size(), svReads);
+        std::vector<bool> keep(mReadStore->size(), false);
+        for(auto& reads: svReads){
+            for(auto& idx: reads) keep[idx] = true;
+        }
+        compactReads(keep);
     }
 }
 
-void SRBamRecordSet::assembleSplitReads(SVSet& svs){
-    // Open file handles
-    samFile* fp = sam_open(mOpt->bamfile.c_str(), "r");
-    hts_set_fai_filename(fp, mOpt->genome.c_str());
-    hts_idx_t* idx = sam_index_load(fp, mOpt->bamfile.c_str());
-    bam_hdr_t* hdr = sam_hdr_read(fp);
-    faidx_t* fai = fai_load(mOpt->genome.c_str());
-    bam1_t* b = bam_init1();
-    // Construct bool filter of SR mapping positions
-    for(uint32_t svt = 0; svt < mSRs.size(); ++svt){
-        for(uint32_t i = 0; i < mSRs[svt].size(); ++i){
-            if(mSRs[svt][i].mSVID == -1 || mSRs[svt][i].mRstart == -1) continue;
-            if(mSRs[svt][i].mRstart < (int32_t)hdr->target_len[mSRs[svt][i].mChr1]){
-                mSRMapPos[mSRs[svt][i].mChr1].insert(std::make_pair(std::make_pair(mSRs[svt][i].mRstart, mSRs[svt][i].mID), mSRs[svt][i].mSVID));
-            }
-            if(mSRs[svt][i].mChr1 != mSRs[svt][i].mChr2 && mSRs[svt][i].mRstart < (int32_t)hdr->target_len[mSRs[svt][i].mChr2]){
-                mSRMapPos[mSRs[svt][i].mChr2].insert(std::make_pair(std::make_pair(mSRs[svt][i].mRstart, mSRs[svt][i].mID), mSRs[svt][i].mSVID));
-            }
+void SRBamRecordSet::releaseReads(){
+    if(!mReadStore) return;
+    std::vector<bool> keep(mReadStore->size(), false);
+    for(auto& srs: mSRs){
+        for(auto& sr: srs){
+            if(sr.mReadIdx != -1) keep[sr.mReadIdx] = true;
         }
     }
-    const uint16_t BAM_RDSKIP_MASK = (BAM_FQCFAIL | BAM_FDUP | BAM_FSECONDARY | BAM_FUNMAP);
-    std::vector<std::multiset<std::string>> traSeqStore(svs.size()); // translocation SR read sequence
-    std::vector<std::vector<uint8_t>> traQualStore(svs.size());      // translocation SR read mapping quality
-    // Parse BAM
-    for(auto& refIdx : mOpt->svRefID){
-        if(mSRMapPos[refIdx].empty()) continue;
-        // Load sequence
-        int32_t seqlen = -1;
-        char* chr1Seq = faidx_fetch_seq(fai, hdr->target_name[refIdx], 0, hdr->target_len[refIdx], &seqlen);
-        std::vector<bool> hits(hdr->target_len[refIdx], false);
-        // Collect all split-read pos 
-        for(auto vsrIter = mSRMapPos[refIdx].begin(); vsrIter != mSRMapPos[refIdx].end(); ++vsrIter){
-            hits[vsrIter->first.first] = true;
-        }
-        // Sequences and quality
-        std::vector<std::multiset<std::string>> seqStore(svs.size());
-        std::vector<std::vector<uint8_t>> qualStore(svs.size());
-        // Collect reads
-        hts_itr_t* bamIter = sam_itr_queryi(idx, refIdx, 0, hdr->target_len[refIdx]);
-        while(sam_itr_next(fp, bamIter, b) >= 0){
-            if(b->core.flag & BAM_RDSKIP_MASK) continue;
-            if(b->core.qual < mOpt->filterOpt->minMapQual || b->core.tid < 0) continue;
-            if(!hits[b->core.pos]) continue;
-            // Valid split-read
-            size_t seed = svutil::hashString(bam_get_qname(b));
-            auto vsrIter = mSRMapPos[refIdx].find(std::make_pair(b->core.pos, seed));
-            if(vsrIter == mSRMapPos[refIdx].end()) continue;
-            int32_t svid = vsrIter->second;
-            int32_t svt = svs[svid].mSVT;
-            // Get SR sequence
-            std::string srseq = bamutil::getSeq(b);
-            // Adjust orientation
-            bool bpPoint = false;
-            if(svt >= 5){// translocation
-                if(b->core.tid == svs[svid].mChr2) bpPoint = true;// bpPoint is true if b is on little chr
-            }else{
-                if(svt == 0){ // bpPoint is true if b is on 3' part of breakpoint
-                    if(b->core.pos > svs[svid].mSVStart - mOpt->filterOpt->minClipLen) bpPoint = true;
-                    else bpPoint = false;
-                }else if(svs[svid].mSVT == 1){
-                    if(b->core.pos > svs[svid].mSVEnd - mOpt->filterOpt->minClipLen) bpPoint = true;
-                    else bpPoint = false;
-                }
-            }
-            SRBamRecord::adjustOrientation(srseq, bpPoint, svt);
-            // At most n split-reads used to to one SV event analysis
-            if((int32_t)seqStore[svid].size() < mOpt->filterOpt->mMaxReadPerSV){
-                if(svt >= 5){
-                    traSeqStore[svid].insert(srseq);
-                    traQualStore[svid].push_back(b->core.qual);
-                }else{
-                    seqStore[svid].insert(srseq);
-                    qualStore[svid].push_back(b->core.qual);
-                }
-            } 
+    compactReads(keep);
+}
+
+void SRBamRecordSet::compactReads(const std::vector<bool>& keep){
+    std::vector<int32_t> newIdx;
+    size_t before = mReadStore->size();
+    mReadStore->compact(keep, newIdx);
+    for(auto& srs: mSRs){
+        for(auto& sr: srs){
+            if(sr.mReadIdx != -1) sr.mReadIdx = newIdx[sr.mReadIdx];
         }
-        // Process all SVs on this chromosome
-        for(uint32_t svid = 0; svid < seqStore.size(); ++svid){
-            if(svs[svid].mSVT >= 5) continue;
-            if(svs[svid].mChr1 != refIdx) continue;
-            // MSA
-            bool bpRefined = false;
-            if(seqStore[svid].size() > 1){
-                AlignConfig alnCfg(5, -4, -10, -1, true, true);// both end gap free to keep each read ungapped as long as possible
-                MSA* msa = new MSA(&seqStore[svid], mOpt->msaOpt->mMinCovForCS, mOpt->msaOpt->mMinBaseRateForCS, &alnCfg);
-                msa->msa(svs[svid].mConsensus);
-                if(svs[svid].refineSRBp(mOpt, hdr, chr1Seq, NULL)) bpRefined = true;
-                if(!bpRefined){
-                    svs[svid].mConsensus = "";
-                    svs[svid].mSVRef = "";
-                    svs[svid].mSRSupport = 0;
-                    svs[svid].mSRAlignQuality = 0;
-                    svs[svid].mSRMapQuality = 0;
-                }else{// SR support and qualities
-                    svs[svid].mSRSupport = seqStore[svid].size();
-                    svs[svid].mSRMapQuality = statutil::median(qualStore[svid]);
-                }
-                delete msa;
-            }
+    }
+    util::loginfo("Captured junction reads kept: " + std::to_string(mReadStore->size()) + " of " + std::to_string(before));
+}
+
+void SRBamRecordSet::getSVReads(size_t nsv, std::vector<std::vector<int32_t>>& svReads){
+    svReads.assign(nsv, std::vector<int32_t>());
+    if(!mReadStore) return;
+    // Assign each captured read to the first SV it supports
+    std::vector<bool> readUsed(mReadStore->size(), false);
+    for(uint32_t svt = 0; svt < mSRs.size(); ++svt){
+        for(uint32_t i = 0; i < mSRs[svt].size(); ++i){
+            if(mSRs[svt][i].mSVID == -1 || mSRs[svt][i].mReadIdx == -1) continue;
+            if(readUsed[mSRs[svt][i].mReadIdx]) continue;
+            readUsed[mSRs[svt][i].mReadIdx] = true;
+            svReads[mSRs[svt][i].mSVID].push_back(mSRs[svt][i].mReadIdx);
         }
-        if(chr1Seq) free(chr1Seq);
     }
-    // Process translocations
-    for(auto liteRefIdx = mOpt->svRefID.begin(); liteRefIdx != mOpt->svRefID.end(); ++liteRefIdx){
-        char* liteChrSeq = NULL;
-        auto largeRefIdx = liteRefIdx;
-        ++largeRefIdx;
-        for(; largeRefIdx !=mOpt->svRefID.end(); ++largeRefIdx){
-            char* largeChrSeq = NULL;
-            // Iterate SVs
-            for(uint32_t svid = 0; svid < traSeqStore.size(); ++svid){
-                if(svs[svid].mChr1 != (*largeRefIdx) || svs[svid].mChr2 != (*liteRefIdx)) continue;
-                bool bpRefined = false;
-                if(traSeqStore[svid].size() > 1){
-                    if(!liteChrSeq){
-                        int32_t liteChrSeqLen = -1;
-                        liteChrSeq = faidx_fetch_seq(fai, hdr->target_name[*liteRefIdx], 0, hdr->target_len[*liteRefIdx], &liteChrSeqLen);
-                    }
-                    if(!largeChrSeq){
-                        int32_t largeChrSeqLen = -1;
-                        largeChrSeq = faidx_fetch_seq(fai, hdr->target_name[*largeRefIdx], 0, hdr->target_len[*largeRefIdx], &largeChrSeqLen);
-                    }
-                    AlignConfig alnCfg(5, -4, -10, -1, true, true);// both end gap free to keep each read ungapped as long as possible
-                    MSA* msa = new MSA(&traSeqStore[svid], mOpt->msaOpt->mMinCovForCS, mOpt->msaOpt->mMinBaseRateForCS, &alnCfg);
-                    msa->msa(svs[svid].mConsensus);
-                    if(svs[svid].refineSRBp(mOpt, hdr, liteChrSeq, largeChrSeq)) bpRefined = true;
-                    if(!bpRefined){
-                        svs[svid].mConsensus = "";
-                        svs[svid].mSVRef = "";
-                        svs[svid].mSRSupport = 0;
-                        svs[svid].mSRAlignQuality = 0;
-                    }else{// SR support and qualities
-                        svs[svid].mSRSupport = traSeqStore[svid].size();
-                        svs[svid].mSRMapQuality = util::median(traQualStore[svid]);
-                    }
-                    delete msa;
-                }
-            }
-            if(largeChrSeq) free(largeChrSeq);
+    // At most n split-reads used to to one SV event analysis, reads mapped ahead are preferred
+    for(auto& reads: svReads){
+        if((int32_t)reads.size() <= mOpt->filterOpt->mMaxReadPerSV) continue;
+        std::sort(reads.begin(), reads.end(), [&](int32_t a, int32_t b){
+            const JunctionRead& ra = mReadStore->mReads[a];
+            const JunctionRead& rb = mReadStore->mReads[b];
+            return ra.mTid < rb.mTid || (ra.mTid == rb.mTid && ra.mPos < rb.mPos) || (ra.mTid == rb.mTid && ra.mPos == rb.mPos && a < b);
+        });
+        reads.resize(mOpt->filterOpt->mMaxReadPerSV);
+    }
+}
+
+void SRBamRecordSet::assembleSplitReads(SVSet& svs){
+    // Open file handles
+    samFile* fp = sam_open(mOpt->bamfile.c_str(), "r");
+    mOpt->attachThreadPool(fp);
+    bam_hdr_t* hdr = sam_hdr_read(fp);
+    std::vector<std::vector<int32_t>> svReads;
+    getSVReads(svs.size(), svReads);
+    // Assemble each SV in parallel, each task only writes the SV it owns
+    // translocations are kept if chr2 < chr1 and both contigs are in svRefID, checked per SV instead of scanning all SVs per contig pair
+    std::vector<int32_t> asmSVs;
+    for(uint32_t svid = 0; svid < svs.size(); ++svid){
+        if(svReads[svid].size() <= 1) continue;
+        if(mOpt->svRefID.find(svs[svid].mChr1) == mOpt->svRefID.end()) continue;
+        if(svs[svid].mSVT >= 5){
+            if(svs[svid].mChr2 >= svs[svid].mChr1) continue;
+            if(mOpt->svRefID.find(svs[svid].mChr2) == mOpt->svRefID.end()) continue;
         }
-        if(liteChrSeq) free(liteChrSeq);
+        asmSVs.push_back(svid);
     }
+    ThreadPool::ThreadPool pool(std::max(1, std::min(mOpt->nthread, (int32_t)asmSVs.size())));
+    std::vector<std::future<void>> rets;
+    for(auto& svid: asmSVs) rets.push_back(pool.enqueue(&SRBamRecordSet::assembleSV, this, &svs[svid], &svReads[svid], hdr));
+    for(auto& e: rets) e.get();
     // Add ChrName
     for(uint32_t i = 0; i < svs.size(); ++i){
         svs[i].mNameChr1 = hdr->target_name[svs[i].mChr1];
@@ -417,8 +395,50 @@ void SRBamRecordSet::assembleSplitReads(SVSet& svs){
     }
     // Clean-up
     sam_close(fp);
-    hts_idx_destroy(idx);
     bam_hdr_destroy(hdr);
-    fai_destroy(fai);
-    bam_destroy1(b);
+}
+
+void SRBamRecordSet::assembleSV(SVRecord* sv, const std::vector<int32_t>* reads, const bam_hdr_t* hdr){
+    // MSA, sequences and alignment config are private to this SV
+    SeqSet seqStore;
+    std::vector<uint8_t> qualStore;
+    getSRSeqs(*sv, *reads, seqStore, qualStore);
+    AlignConfig alnCfg(5, -4, -10, -1, true, true);// both end gap free to keep each read ungapped as long as possible
+    MSA msa(&seqStore, mOpt->msaOpt->mMinCovForCS, mOpt->msaOpt->mMinBaseRateForCS, &alnCfg);
+    msa.msa(sv->mConsensus);
+    if(!sv->refineSRBp(mOpt, hdr)){
+        sv->mConsensus = "";
+        sv->mSVRef = "";
+        sv->mSRSupport = 0;
+        sv->mSRAlignQuality = 0;
+        sv->mSRMapQuality = 0;
+    }else{// SR support and qualities
+        sv->mSRSupport = seqStore.total();
+        sv->mSRMapQuality = statutil::median(qualStore);
+    }
+}
+
+void SRBamRecordSet::getSRSeqs(const SVRecord& sv, const std::vector<int32_t>& reads, SeqSet& seqs, std::vector<uint8_t>& quals){
+    for(auto& idx: reads){
+        const JunctionRead& jr = mReadStore->mReads[idx];
+        // Get SR sequence
+        std::string srseq = mReadStore->getSeq(idx);
+        // Adjust orientation
+        bool bpPoint = false;
+        if(sv.mSVT >= 5){// translocation
+            if(jr.mTid == sv.mChr2) bpPoint = true;// bpPoint is true if read is on little chr
+        }else{
+            if(sv.mSVT == 0){ // bpPoint is true if read is on 3' part of breakpoint
+                if(jr.mPos > sv.mSVStart - mOpt->filterOpt->minClipLen) bpPoint = true;
+                else bpPoint = false;
+            }else if(sv.mSVT == 1){
+                if(jr.mPos > sv.mSVEnd - mOpt->filterOpt->minClipLen) bpPoint = true;
+                else bpPoint = false;
+            }
+        }
+        SRBamRecord::adjustOrientation(srseq, bpPoint, sv.mSVT);
+        seqs.add(srseq);
+        quals.push_back(jr.mQual);
+    }
+    seqs.finish();
 }
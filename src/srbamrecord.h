@@ -10,20 +10,21 @@
 #include "bamutil.h"
 #include "options.h"
 #include "junction.h"
+#include "radixsort.h"
+#include "subsample.h"
 #include "svrecord.h"
 #include "edgerecord.h"
 
-/** class to store split read alignment record */
+/** class to store split read alignment record, packed into 24 bytes\n
+ * reference ids are stored in 16 bits, and (chr1, pos1, chr2) are packed into one 64-bit sort key
+ */
 class SRBamRecord{
     public:
-        int32_t mChr1;   ///< reference id part1 of read mapped
-        int32_t mPos1;   ///< break point position of part1 read on reference
-        int32_t mChr2;   ///< reference id part2 of read mapped
-        int32_t mPos2;   ///< break point position of part2 read on reference
-        int32_t mRstart; ///< starting mapping position on reference of one part read which is not -1
-        int32_t mInslen; ///< insert size of two part of one read contributed
-        int32_t mSVID;   ///< default -1, if allocated to an StructuralVariant, it is the index at which to store a StructuralVariant in vector
-        size_t mID;      ///< hash value of the read name
+        uint64_t mKey;    ///< chr1 << 48 | pos1 << 16 | chr2, chr1/chr2 is reference id part1/part2 of read mapped, pos1 is break point position of part1 read on reference
+        int32_t mPos2;    ///< break point position of part2 read on reference
+        int32_t mInslen;  ///< insert size of two part of one read contributed
+        int32_t mSVID;    ///< default -1, if allocated to an StructuralVariant, it is the index at which to store a StructuralVariant in vector
+        int32_t mReadIdx; ///< index of the primary read captured in JunctionReadStore, -1 if not captured
 
     public:
         /** construct SRBamRecord object
@@ -31,19 +32,36 @@ class SRBamRecord{
          * @param pos1 break point position of part1 read on reference
          * @param chr2 reference id part2 of read mapped
          * @param pos2 break point position of part2 read on reference
-         * @param rstart starting mapping position on reference of one part read which is not -1
          * @param inslen insert size of two part of one read contributed
-         * @param id hash value of the read name
+         * @param readIdx index of the primary read captured in JunctionReadStore, -1 if not captured
          */
-        SRBamRecord(int32_t chr1, int32_t pos1, int32_t chr2, int32_t pos2, int32_t rstart, int32_t inslen, size_t id){
-            mChr1 = chr1;
-            mPos1 = pos1;
-            mChr2 = chr2;
+        SRBamRecord(int32_t chr1, int32_t pos1, int32_t chr2, int32_t pos2, int32_t inslen, int32_t readIdx = -1){
+            mKey = ((uint64_t)(uint16_t)chr1 << 48) | ((uint64_t)(uint32_t)pos1 << 16) | (uint16_t)chr2;
             mPos2 = pos2;
-            mRstart = rstart;
             mInslen = inslen;
             mSVID = -1;
-            mID = id;
+            mReadIdx = readIdx;
+        }
+
+        /** get reference id part1 of read mapped
+         * @return reference id part1 of read mapped
+         */
+        inline int32_t chr1() const {
+            return mKey >> 48;
+        }
+
+        /** get break point position of part1 read on reference
+         * @return break point position of part1 read on reference
+         */
+        inline int32_t pos1() const {
+            return (uint32_t)(mKey >> 16);
+        }
+
+        /** get reference id part2 of read mapped
+         * @return reference id part2 of read mapped
+         */
+        inline int32_t chr2() const {
+            return mKey & 0xffff;
         }
 
         /** SRBamRecord destructor */
@@ -68,13 +86,13 @@ class SRBamRecord{
          */
         inline friend std::ostream& operator<<(std::ostream& os, const SRBamRecord& sr){
             os << "===============================================================\n";
-            os << "Part1 of Split Read Reference ID: " << sr.mChr1 << "\n";
-            os << "Part1 of Split Read Breakpoint Position on Reference: " << sr.mPos1 << "\n";
-            os << "Part2 of Split Read Reference ID: " << sr.mChr2 << "\n";
+            os << "Part1 of Split Read Reference ID: " << sr.chr1() << "\n";
+            os << "Part1 of Split Read Breakpoint Position on Reference: " << sr.pos1() << "\n";
+            os << "Part2 of Split Read Reference ID: " << sr.chr2() << "\n";
             os << "Part2 of SPlit Read Breakpoint Position on Reference: " << sr.mPos2 << "\n";
             os << "Insert size contribured by Part1 and Part2 of Split Read: " << sr.mInslen << "\n";
             os << "ID of Structural Variant this Split Read contributed to: " << sr.mSVID << "\n";
-            os << "Hash value of Split Read name: " << sr.mID << "\n";
+            os << "Captured Read Index: " << sr.mReadIdx << "\n";
             os << "===============================================================\n";
             return os;
         }
@@ -84,22 +102,16 @@ class SRBamRecord{
          * @return true if this SRBamRecord is less than other
          */
         inline bool operator<(const SRBamRecord& other) const {
-            return mChr1 < other.mChr1 ||
-               (mChr1 == other.mChr1 && mPos1 < other.mPos1) ||
-               (mChr1 == other.mChr1 && mPos1 == other.mPos1 && mChr2 < other.mChr2) ||
-               (mChr1 == other.mChr1 && mPos1 == other.mPos1 && mChr2 == other.mChr2 && mPos2 < other.mPos2);
+            return mKey < other.mKey || (mKey == other.mKey && mPos2 < other.mPos2);
         }
 };
 
-/** class to store SR information on each contig */
-typedef std::vector<std::map<std::pair<int32_t, size_t>, int32_t>> ContigSRs; ///<[contig]<<mRstart, mID>, mSVID>
-
 /** class to store SRBamRecord supporting various SVs */
 class SRBamRecordSet{
     public:
         Options* mOpt;                              ///< pointer to Options object
         std::vector<std::vector<SRBamRecord>> mSRs; ///< vector to store SRBamRecords accordint the SV they support
-        ContigSRs mSRMapPos;                        ///< SR mapping starting position on each contig with SV Type defined
+        JunctionReadStore* mReadStore;              ///< junction reads captured while scanning, NULL if not available
         bool mSorted = false;                       ///< all SRBamRecords have been sorted if true
     public:
         /** SRBamRecordSet constructor 
@@ -109,17 +121,18 @@ class SRBamRecordSet{
         SRBamRecordSet(Options* opt, JunctionMap* jctMap = NULL){
             mOpt = opt;
             mSRs.resize(9);
-            mSRMapPos.resize(mOpt->contigNum);
+            mReadStore = jctMap ? &jctMap->mReadStore : NULL;
             if(jctMap) classifyJunctions(jctMap);
         }
 
         /** SRBamRecordSet destructor */
         ~SRBamRecordSet(){}
 
-        /** sort SRBamRecords in mSRs */
+        /** sort SRBamRecords in mSRs by (mKey, mPos2), SRBamRecords with equal key keep their insertion order */
         void sortSRs(){
             for(auto& svt : mOpt->SVTSet){
-                std::sort(mSRs[svt].begin(), mSRs[svt].end());
+                RadixSorter::sort(mSRs[svt], [](const SRBamRecord& sr){return (uint32_t)sr.mPos2;}, 4, mOpt->nthread);
+                RadixSorter::sort(mSRs[svt], [](const SRBamRecord& sr){return sr.mKey;}, 8, mOpt->nthread);
             }
             mSorted = true;
         }
@@ -146,33 +159,95 @@ class SRBamRecordSet{
          */
         void classifyJunctions(JunctionMap* jctMap);
 
-        /** cluster SRBamRecord of one type SV and find all supporting SV of this type\n
-         * step1: cluster SRBamRecord into different component, SRBamRecord with same chr1, pos1 abs diff in a limit[MaxReadSep](only considre nearing two) consists a component\n
+        /** class all Junction records of one read into SRBamRecord vector according to SV type they support
+         * @param jcts pointer to the first Junction record of the read, records are sorted
+         * @param n number of Junction records of the read
+         */
+        void classifyRead(const Junction* jcts, uint32_t n);
+
+        /** move all SRBamRecords of another SRBamRecordSet to the end of this SRBamRecordSet
+         * @param other pointer to SRBamRecordSet to merge from
+         * @param readBase offset added to captured read index of SRBamRecords merged
+         */
+        inline void merge(SRBamRecordSet* other, int32_t readBase){
+            for(uint32_t svt = 0; svt < mSRs.size(); ++svt){
+                for(auto& sr: other->mSRs[svt]){
+                    mSRs[svt].push_back(sr);
+                    if(sr.mReadIdx != -1) mSRs[svt].back().mReadIdx += readBase;
+                }
+                std::vector<SRBamRecord>().swap(other->mSRs[svt]);
+            }
+            mSorted = false;
+        }
+
+        /** cluster SRBamRecord of one type SV on one chr1 and find all supporting SV of this type\n
+         * step1: cluster SRBamRecord into different component, SRBamRecord with pos1 abs diff in a limit[MaxReadSep](only considre nearing two) consists a component\n
          * step2: search each component for an clique, use the EdgeRecord in a component with the least weight as an seed, grow the clique as big as possible\n
-         * @param srs reference of SRBamRecords which supporting SV type svt
-         * @param svs SVSet used to store SV found
+         * SV found are numbered from svs->size(), SRBamRecords outside [beg, end) are not touched
+         * @param srs pointer to SRBamRecords which supporting SV type svt
+         * @param beg index of the first SRBamRecord on chr1
+         * @param end index past the last SRBamRecord on chr1
+         * @param svs pointer to SVSet used to store SV found
          * @param svt SV type to find in srs, range [0-8]
          */
-        void cluster(std::vector<SRBamRecord>& srs, SVSet& svs, int32_t svt);
+        void clusterPartition(std::vector<SRBamRecord>* srs, size_t beg, size_t end, SVSet* svs, int32_t svt);
         
-        /** cluster all SRBamRecord in SRBamRecordSet into their seperate supporting SVs */
+        /** cluster all SRBamRecord in SRBamRecordSet into their seperate supporting SVs\n
+         * each (svt, chr1) partition is clustered in parallel, SV IDs are assigned in partition order afterwards\n
+         * captured reads not used to assemble any SV are released from mReadStore after clustered, so at most mMaxReadPerSV reads of each SV are kept
+         * @param svs SVSet used to store SV found
+         */
         void cluster(SVSet& svs);
 
-        /** a subroutine used to search all possible clique supporting an type of SV\n
+        /** keep only captured reads referenced by any SRBamRecord in mReadStore, should be called once all reads classified\n
+         * so junction reads forming no SR are released before clustering
+         */
+        void releaseReads();
+
+        /** drop captured reads not kept from mReadStore, mReadIdx of all SRBamRecords are updated, -1 if read dropped
+         * @param keep keep[i] is true if read i in mReadStore is kept
+         */
+        void compactReads(const std::vector<bool>& keep);
+
+        /** get captured reads used to assemble each SV, each read is assigned to the first SV it supports,\n
+         * at most mMaxReadPerSV reads of each SV are used, reads mapped ahead are preferred
+         * @param nsv number of SVs found
+         * @param svReads vector to store index of reads in mReadStore used by each SV
+         */
+        void getSVReads(size_t nsv, std::vector<std::vector<int32_t>>& svReads);
+
+        /** a subroutine used to search an clique supporting an type of SV in one component\n
          * step1: select seed, use the EdgeRecord in a component with the least weight as an seed of clique\n
          * step2: grow the clique, add another component if the expanded clique have starting/ending position diff smaller than a limit[MaxReadSep]\n
-         * @param compEdge <compNumber, components> pairs clustered from SRBamRecords
+         * @param edges edges of one component clustered from SRBamRecords
          * @param srs reference of SRBamRecords which supporting SV type svt
          * @param svs SVSet used to store SV found
          * @param svt SV type to find in srs, range [0-8]
+         * @param scratch buffers reused across components
          */
-        void searchCliques(std::map<int32_t, std::vector<EdgeRecord>>& compEdge, std::vector<SRBamRecord>& srs, SVSet& svs, int32_t svt);
+        void searchCliques(const std::vector<EdgeRecord>& edges, std::vector<SRBamRecord>& srs, SVSet& svs, int32_t svt, CliqueScratch& scratch);
 
         /** assembly reads of SR supporting each SV by MSA to get an consensus representation of SRs,\n
-         * split align the consensus sequence against the constructed reference sequence to refine the breakpoint position
+         * split align the consensus sequence against the constructed reference sequence to refine the breakpoint position,\n
+         * each SV, translocations included, is assembled by an independent task
          * @param svs reference of SVSet
          */
         void assembleSplitReads(SVSet& svs);
+
+        /** assembly split reads of one SV and refine its breakpoint
+         * @param sv pointer to SVRecord to assemble
+         * @param reads index of reads in mReadStore supporting sv
+         * @param hdr pointer to bam header
+         */
+        void assembleSV(SVRecord* sv, const std::vector<int32_t>* reads, const bam_hdr_t* hdr);
+
+        /** get orientation adjusted sequences and mapping qualities of split reads supporting an SV
+         * @param sv reference of SVRecord
+         * @param reads index of reads in mReadStore supporting sv
+         * @param seqs SeqSet to store unique read sequences with their multiplicity
+         * @param quals vector to store read mapping qualities
+         */
+        void getSRSeqs(const SVRecord& sv, const std::vector<int32_t>& reads, SeqSet& seqs, std::vector<uint8_t>& quals);
 };
 
 #endif
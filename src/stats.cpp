@@ -1,8 +1,10 @@
 #include "stats.h"
+#include <queue>
 
-Stats::Stats(Options* opt, int32_t n, int32_t refidx){
+Stats::Stats(Options* opt, int32_t n, const GenomeTile& tile){
     mOpt = opt;
-    mRefIdx = refidx;
+    mRefIdx = tile.mTid;
+    mTile = tile;
     init(n);
 }
 
@@ -17,8 +19,6 @@ void Stats::init(int n){
     mJctCnts.resize(n, JunctionCount());
     mSpnCnts.resize(n, SpanningCount());
     mCovCnts.resize(3 * n, {0, 0});
-    mRefAlignedReadCount.resize(n, 0);
-    mRefAlignedSpanCount.resize(n, 0);
 }
 
 uint32_t Stats::getAlignmentQual(Matrix2D<char>* alnResult, const uint8_t* qual){
@@ -37,64 +37,74 @@ uint32_t Stats::getAlignmentQual(Matrix2D<char>* alnResult, const uint8_t* qual)
     return baseQualSum/alignedBases;
 }
 
-Stats* Stats::merge(const std::vector<Stats*>& sts, int32_t n){
-    Stats* ret = new Stats(n);
-    ret->mOpt = sts[0]->mOpt;
-    for(int32_t j = 0; j < n; ++j){
-        for(uint32_t i = 0; i < sts.size(); ++i){
-            // RC
-            ret->mReadCnts[j].mLeftRC += sts[i]->mReadCnts[j].mLeftRC;
-            ret->mReadCnts[j].mRightRC += sts[i]->mReadCnts[j].mRightRC;
-            ret->mReadCnts[j].mRC += sts[i]->mReadCnts[j].mRC;
-            // JC
-            ret->mJctCnts[j].mAlth1 += sts[i]->mJctCnts[j].mAlth1;
-            ret->mJctCnts[j].mAlth2 += sts[i]->mJctCnts[j].mAlth2;
-            ret->mJctCnts[j].mRefh1 += sts[i]->mJctCnts[j].mRefh1;
-            ret->mJctCnts[j].mAltQual.insert(ret->mJctCnts[j].mAltQual.end(), sts[i]->mJctCnts[j].mAltQual.begin(), sts[i]->mJctCnts[j].mAltQual.end());
-            ret->mJctCnts[j].mRefQual.insert(ret->mJctCnts[j].mRefQual.end(), sts[i]->mJctCnts[j].mRefQual.begin(), sts[i]->mJctCnts[j].mRefQual.end());
-            // SC
-            ret->mSpnCnts[j].mAlth1 += sts[i]->mSpnCnts[j].mAlth1;
-            ret->mSpnCnts[j].mAlth2 += sts[i]->mSpnCnts[j].mAlth2;
-            ret->mSpnCnts[j].mRefh1 += sts[i]->mSpnCnts[j].mRefh1;
-            ret->mSpnCnts[j].mAltQual.insert(ret->mSpnCnts[j].mAltQual.end(), sts[i]->mSpnCnts[j].mAltQual.begin(), sts[i]->mSpnCnts[j].mAltQual.end());
-            ret->mSpnCnts[j].mRefQual.insert(ret->mSpnCnts[j].mRefQual.end(), sts[i]->mSpnCnts[j].mRefQual.begin(), sts[i]->mSpnCnts[j].mRefQual.end());
-            // Cov
-            ret->mCovCnts[j].first += sts[i]->mCovCnts[j].first;
-            ret->mCovCnts[j].second += sts[i]->mCovCnts[j].second;
-            // REF Reads
-            ret->mRefAlignedReadCount[j] += sts[i]->mRefAlignedReadCount[j];
-            // REF Pairs
-            ret->mRefAlignedSpanCount[j] += sts[i]->mRefAlignedSpanCount[j];
-        }
+void Stats::merge(Stats* other){
+    for(uint32_t j = 0; j < mReadCnts.size(); ++j){
+        // JC
+        mJctCnts[j].mAlth1 += other->mJctCnts[j].mAlth1;
+        mJctCnts[j].mAlth2 += other->mJctCnts[j].mAlth2;
+        mJctCnts[j].mRefh1 += other->mJctCnts[j].mRefh1;
+        mJctCnts[j].mRefh2 += other->mJctCnts[j].mRefh2;
+        mJctCnts[j].mAltQual.insert(mJctCnts[j].mAltQual.end(), other->mJctCnts[j].mAltQual.begin(), other->mJctCnts[j].mAltQual.end());
+        mJctCnts[j].mRefQual.insert(mJctCnts[j].mRefQual.end(), other->mJctCnts[j].mRefQual.begin(), other->mJctCnts[j].mRefQual.end());
+        // SC
+        mSpnCnts[j].mAlth1 += other->mSpnCnts[j].mAlth1;
+        mSpnCnts[j].mAlth2 += other->mSpnCnts[j].mAlth2;
+        mSpnCnts[j].mRefh1 += other->mSpnCnts[j].mRefh1;
+        mSpnCnts[j].mRefh2 += other->mSpnCnts[j].mRefh2;
+        mSpnCnts[j].mAltQual.insert(mSpnCnts[j].mAltQual.end(), other->mSpnCnts[j].mAltQual.begin(), other->mSpnCnts[j].mAltQual.end());
+        mSpnCnts[j].mRefQual.insert(mSpnCnts[j].mRefQual.end(), other->mSpnCnts[j].mRefQual.begin(), other->mSpnCnts[j].mRefQual.end());
+    }
+    // Cov
+    for(uint32_t j = 0; j < mCovCnts.size(); ++j){
+        mCovCnts[j].first += other->mCovCnts[j].first;
+        mCovCnts[j].second += other->mCovCnts[j].second;
+    }
+    // Pairs across tiles
+    for(auto& e: other->mMates) mMates[e.first] = e.second;
+    other->mMates.clear();
+    mPendingReads.insert(mPendingReads.end(), other->mPendingReads.begin(), other->mPendingReads.end());
+    other->mPendingReads.clear();
+    if(!other->mTraReads.empty()){
+        if(!mTraSpill) mTraSpill = new TraSpill();
+        mTraSpill->addRun(other->mTraReads);
     }
-    return ret;
 }
 
-void Stats::stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& covRecs, const ContigBpRegions& bpRegs, const ContigSpanPoints& spPts, std::unordered_map<size_t, uint8_t>& transQuals, std::unordered_map<size_t, bool>& transClips){
+void Stats::stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& covRecs, const ContigBpRegions& bpRegs, const ContigSpanPoints& spPts){
     samFile* fp = sam_open(mOpt->bamfile.c_str(), "r");
+    mOpt->attachThreadPool(fp);
     bam_hdr_t* h = sam_hdr_read(fp);
-    util::loginfo("Start gathering coverage information on contig: " + std::string(h->target_name[mRefIdx]), mOpt->logMtx);
-    // Flag breakpoint regions
-    std::vector<bool> bpOccupied(h->target_len[mRefIdx], false);
+    std::string tileName = std::string(h->target_name[mRefIdx]) + ":" + std::to_string(mTile.mBeg) + "-" + std::to_string(mTile.mEnd);
+    util::loginfo("Start gathering coverage information on tile: " + tileName, mOpt->logMtx);
+    int32_t refLen = h->target_len[mRefIdx];
+    // Merge breakpoint regions
+    std::vector<std::pair<int32_t, int32_t>> bpOccupied;
     for(uint32_t i = 0; i < bpRegs[mRefIdx].size(); ++i){
-        for(int32_t k = bpRegs[mRefIdx][i].mRegStart; k < bpRegs[mRefIdx][i].mRegEnd; ++k){
-            bpOccupied[k] = true;
+        if(bpRegs[mRefIdx][i].mRegStart < bpRegs[mRefIdx][i].mRegEnd){
+            bpOccupied.push_back(std::make_pair(bpRegs[mRefIdx][i].mRegStart, bpRegs[mRefIdx][i].mRegEnd));
         }
     }
-    // Flag spanning breakpoints
-    std::vector<bool> spanBp(h->target_len[mRefIdx], false);
-    for(uint32_t i = 0; i < spPts[mRefIdx].size(); ++i) spanBp[spPts[mRefIdx][i].mBpPos] = true;
+    if(!bpOccupied.empty()) bpOccupied = Region::mergeAndSortRegions(bpOccupied);
     // Count reads
-    hts_idx_t* idx = sam_index_load(fp, mOpt->bamfile.c_str());
-    hts_itr_t* itr = sam_itr_queryi(idx, mRefIdx, 0, h->target_len[mRefIdx]);
+    hts_idx_t* idx = NULL;
+    RecordReader* reader = NULL;
+    if(mStore) reader = new RecordReader(mStore->mCovReads, mTile.mIdx, mTile.mIdx + 1);
+    else{
+        idx = sam_index_load(fp, mOpt->bamfile.c_str());
+        reader = new RecordReader(fp, idx, mRefIdx, mTile.mBeg, mTile.mEnd);
+    }
     bam1_t* b = bam_init1();
-    int32_t lastAlignedPos = 0;
-    std::set<size_t> lastAlignedPosReads;
+    SamePosReads lastAlignedPosReads;
     AlignConfig alnCfg(5, -4, -4, -4, false, true);   
     const uint16_t COV_STAT_SKIP_MASK = (BAM_FSECONDARY | BAM_FQCFAIL | BAM_FDUP | BAM_FSUPPLEMENTARY | BAM_FUNMAP | BAM_FMUNMAP);
-    std::unordered_map<size_t, uint8_t> qualities;
-    std::unordered_map<size_t, bool> clip;
-    while(sam_itr_next(fp, itr, b) >= 0){
+    // Mapping quality and clipping status of first reads whose mate are on this tile, dropped once scan passes their mate
+    MateJoinTable<std::pair<uint8_t, bool>> mates;
+    // Reads of inter-chromosomal pairs are ordered by their ordinal in this tile
+    uint64_t traKey = (uint64_t)mTile.mIdx << 32;
+    std::vector<int32_t> spanIDs;
+    while(reader->next(b)){
+        if(!mTile.owns(b)) continue;
+        mates.evict(MateJoinTable<std::pair<uint8_t, bool>>::locus(b->core.tid, b->core.pos));
         if(b->core.flag & COV_STAT_SKIP_MASK) continue;
         if(b->core.qual < mOpt->filterOpt->mMinGenoQual) continue;
         // Count aligned basepair (small InDels)
@@ -131,14 +141,8 @@ void Stats::stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& co
         }
         // Check read length for junction annotation
         if(b->core.l_qseq > 2 * mOpt->filterOpt->mMinFlankSize){
-            bool bpvalid = false;
             int32_t rbegin = std::max(0, b->core.pos - leadingSC);
-            for(int32_t k = rbegin; k < (b->core.pos + b->core.l_qseq) && k < (int32_t)h->target_len[mRefIdx]; ++k){
-                if(bpOccupied[k]){
-                    bpvalid = true;
-                    break;
-                }
-            }
+            bool bpvalid = overlapAny(bpOccupied, rbegin, std::min(b->core.pos + b->core.l_qseq, refLen));
             if(bpvalid){
                 // Fetch all relevant SVs
                 auto itbp = std::lower_bound(bpRegs[mRefIdx].begin(), bpRegs[mRefIdx].end(), BpRegion(rbegin));
@@ -167,7 +171,7 @@ void Stats::stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& co
                         // Any confident alignment?
                         if(scoreRef > 1 || scoreAlt > 1){
                             if(scoreRef > scoreAlt){// Account for reference bias
-                                if(++mRefAlignedReadCount[itbp->mID] % 2){
+                                if(refSampled(b, itbp->mID)){
                                     uint8_t* qual = bam_get_qual(b);
                                     uint32_t rq = getAlignmentQual(refResult, qual);
                                     if(rq >= mOpt->filterOpt->mMinGenoQual){
@@ -211,22 +215,19 @@ void Stats::stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& co
         // Read-count and spanning annotation
         if((!(b->core.flag & BAM_FPAIRED)) || covRecs[b->core.mtid].empty()) continue;
         // Clean-up the read store for identical alignment positions
-        if(b->core.pos > lastAlignedPos){
-            lastAlignedPosReads.clear();
-            lastAlignedPos = b->core.pos;
-        }
+        lastAlignedPosReads.advance(b->core.pos);
         if(firstInPair(b, lastAlignedPosReads)){
             // First read in pair
-            lastAlignedPosReads.insert(svutil::hashString(bam_get_qname(b)));
+            lastAlignedPosReads.add(svutil::hashString(bam_get_qname(b)));
             size_t hv = svutil::hashPairCurr(b);
             if(b->core.tid == b->core.mtid){
-                qualities[hv] = b->core.qual;
-                clip[hv] = hasSoftClip;
+                if(mTile.mateAfter(b)){
+                    mMates[hv] = std::make_pair(b->core.qual, hasSoftClip);
+                }else{
+                    mates.insert(hv, MateJoinTable<std::pair<uint8_t, bool>>::locus(b->core.mtid, b->core.mpos), std::make_pair(b->core.qual, hasSoftClip));
+                }
             }else{
-                mOpt->traMtx.lock();
-                transQuals[hv] = b->core.qual;
-                transClips[hv] = hasSoftClip;
-                mOpt->traMtx.unlock();
+                mTraReads.push_back(TraRead(hv, traKey++, -1, b->core.qual, 0));
             }
         }else{
             // Second read in pair
@@ -234,110 +235,107 @@ void Stats::stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& co
             uint8_t pairQual = 0;
             bool pairClip = false;
             if(b->core.tid == b->core.mtid){
-                if(qualities.find(hv) == qualities.end()) continue;
-                pairQual = std::min(qualities[hv], b->core.qual);
-                if(clip[hv] || hasSoftClip) pairClip = true;
-                qualities[hv] = 0;
-                clip[hv] = false;
-            }else{
-                mOpt->traMtx.lock();
-                if(transQuals.find(hv) == transQuals.end()){
-                    mOpt->traMtx.unlock();
+                if(mTile.mateBefore(b)){// Mate will be joined after all tiles finished
+                    mPendingReads.push_back(std::make_pair(bam_dup1(b), hasSoftClip));
                     continue;
                 }
-                pairQual = std::min(transQuals[hv], b->core.qual);
-                if(transClips[hv] || hasSoftClip) pairClip = true;
-                transQuals[hv] = 0;
-                transClips[hv] = false;
-                mOpt->traMtx.unlock();
+                std::pair<uint8_t, bool>* mit = mates.find(hv);
+                if(!mit) continue;
+                pairQual = std::min(mit->first, b->core.qual);
+                if(mit->second || hasSoftClip) pairClip = true;
+                mit->first = 0;
+                mit->second = false;
+            }else{// Mate will be joined on disk after all tiles finished, only spanning information is needed
+                spanIDs.clear();
+                getAbnormalSpans(b, refLen, spPts, spanIDs);
+                for(auto& id: spanIDs) mTraReads.push_back(TraRead(hv, traKey, id, b->core.qual, getHap(b)));
+                ++traKey;
+                continue;
             }
-            // Pair quality
-            if(pairQual < mOpt->filterOpt->mMinGenoQual) continue; // Low quality pair
-            // Read-depth fragment counting
-            if(b->core.tid == b->core.mtid){
-                // Count mid point (fragment counting)
-                int32_t midPos = b->core.pos + bam_cigar2rlen(b->core.n_cigar, bam_get_cigar(b))/2;
-                // Assign fragment counts to SVs
-                for(uint32_t rc = 0; rc < covRecs[mRefIdx].size(); ++rc){
-                    if(midPos >= covRecs[mRefIdx][rc].mStart && midPos < covRecs[mRefIdx][rc].mEnd){
-                        mCovCnts[covRecs[mRefIdx][rc].mID].second += 1;
-                        break;
-                    }
-                }
-            }
-            // Spanning counting
-            int32_t outerISize = b->core.pos + b->core.l_qseq - b->core.mpos;
-            // Normal spanning pair
-            if((!pairClip) && (DPBamRecord::getSVType(b) == 2) && outerISize >= mOpt->libInfo->mMinNormalISize &&
-               outerISize <= mOpt->libInfo->mMaxNormalISize && b->core.mtid == b->core.tid){
-                // Take 80% of the outersize as the spanned interval
-                int32_t spanlen = 0.8 * outerISize;
-                int32_t pbegin = b->core.mpos;
-                int32_t st = pbegin + 0.1 * outerISize;
-                bool spanvalid = false;
-                for(int32_t i = st; i < st + spanlen && i < (int32_t)h->target_len[mRefIdx]; ++i){
-                    if(spanBp[i]){
-                        spanvalid = true;
-                        break;
-                    }
-                }
-                if(spanvalid){
-                    // Fetch all relevant SVs
-                    auto itspan = std::lower_bound(spPts[mRefIdx].begin(), spPts[mRefIdx].end(), SpanPoint(st));
-                    for(; itspan != spPts[mRefIdx].end() && (st + spanlen) >= itspan->mBpPos; ++itspan){
-                        // Account for reference bias
-                        if(++mRefAlignedSpanCount[itspan->mID] % 2){
-                            uint8_t* hpptr = bam_aux_get(b, "HP");
-                            mSpnCnts[itspan->mID].mRefQual.push_back(pairQual);
-                            if(hpptr){
-                                mOpt->libInfo->mIsHaploTagged = true;
-                                int hap = bam_aux2i(hpptr);
-                                if(hap == 1) ++mSpnCnts[itspan->mID].mRefh1;
-                                else ++mSpnCnts[itspan->mID].mRefh2;
-                            }
-                        }
-                    }
-                }
+            statPair(b, pairQual, pairClip, refLen, covRecs, spPts);
+        }
+    }
+    std::sort(mTraReads.begin(), mTraReads.end());
+    util::loginfo("Finish gathering coverage information on tile: " + tileName, mOpt->logMtx);
+    // Clean-up
+    sam_close(fp);
+    bam_hdr_destroy(h);
+    bam_destroy1(b);
+    delete reader;
+    if(idx) hts_idx_destroy(idx);
+}
+
+void Stats::statPending(const std::vector<std::vector<CovRecord>>& covRecs, const ContigSpanPoints& spPts){
+    samFile* fp = sam_open(mOpt->bamfile.c_str(), "r");
+    mOpt->attachThreadPool(fp);
+    bam_hdr_t* h = sam_hdr_read(fp);
+    for(auto& e: mPendingReads){
+        bam1_t* b = e.first;
+        size_t hv = svutil::hashPairMate(b);
+        auto mit = mMates.find(hv);
+        if(mit == mMates.end()) continue;
+        uint8_t pairQual = std::min(mit->second.first, b->core.qual);
+        bool pairClip = mit->second.second || e.second;
+        mit->second.first = 0;
+        mit->second.second = false;
+        statPair(b, pairQual, pairClip, h->target_len[b->core.tid], covRecs, spPts);
+    }
+    for(auto& e: mPendingReads) bam_destroy1(e.first);
+    mPendingReads.clear();
+    mMates.clear();
+    sam_close(fp);
+    bam_hdr_destroy(h);
+    // Join inter-chromosomal pairs, first reads of each pair are merged before its second reads
+    if(!mTraSpill) return;
+    mTraSpill->rewind();
+    TraRead r;
+    bool got = mTraSpill->next(r);
+    while(got){
+        size_t hv = r.mHash;
+        bool hasMate = false;
+        uint8_t mateQual = 0;
+        for(; got && r.mHash == hv && r.mFirst; got = mTraSpill->next(r)){
+            hasMate = true;
+            mateQual = r.mQual;
+        }
+        // Only the first second read is joined if mate mapped to multiple place
+        uint64_t joinedKey = r.mKey;
+        for(; got && r.mHash == hv; got = mTraSpill->next(r)){
+            if(!hasMate || r.mKey != joinedKey) continue;
+            uint8_t pairQual = std::min(mateQual, r.mQual);
+            if(pairQual < mOpt->filterOpt->mMinGenoQual) continue;
+            addAltSpan(r.mSpanID, pairQual, r.mHap);
+        }
+    }
+    delete mTraSpill;
+    mTraSpill = NULL;
+}
+
+void Stats::countFragments(const std::vector<std::vector<CovRecord>>& covRecs, const OnePassStore* store){
+    std::vector<int32_t> midPos;
+    for(auto& track: store->mTracks){
+        const std::vector<CovRecord>& recs = covRecs[track->mTid];
+        if(recs.empty() || !track->mCount) continue;
+        track->unpack(midPos);
+        // Sweep midpoints, active records contain current midpoint and are ordered as in recs
+        std::set<uint32_t> active;
+        std::priority_queue<std::pair<int32_t, uint32_t>, std::vector<std::pair<int32_t, uint32_t>>, std::greater<std::pair<int32_t, uint32_t>>> ends;
+        uint32_t nextRec = 0;
+        for(auto& pos: midPos){
+            for(; nextRec < recs.size() && recs[nextRec].mStart <= pos; ++nextRec){
+                active.insert(nextRec);
+                ends.push(std::make_pair(recs[nextRec].mEnd, nextRec));
             }
-            // Abnormal spanning coverage
-            if((DPBamRecord::getSVType(b) != 2) || outerISize < mOpt->libInfo->mMinNormalISize || outerISize > mOpt->libInfo->mMaxNormalISize || b->core.tid != b->core.mtid){
-                // Get SV type
-                int32_t svt =  DPBamRecord::getSVType(b, mOpt);
-                if(svt == -1) continue;
-                // Spanning a breakpoint?
-                bool spanvalid = false;
-                int32_t pbegin = b->core.pos;
-                int32_t pend = std::min(b->core.pos + mOpt->libInfo->mMaxNormalISize, (int32_t)h->target_len[mRefIdx]);
-                if(b->core.flag & BAM_FREVERSE){
-                    pbegin = std::max(0, b->core.pos + b->core.l_qseq - mOpt->libInfo->mMaxNormalISize);
-                    pend = std::min(b->core.pos + b->core.l_qseq, (int32_t)h->target_len[mRefIdx]);
-                }
-                for(int32_t i = pbegin; i < pend; ++i){
-                    if(spanBp[i]){
-                        spanvalid = true;
-                        break;
-                    }
-                }
-                if(spanvalid){
-                    // Fetch all relevant SVs
-                    auto itspan = std::lower_bound(spPts[mRefIdx].begin(), spPts[mRefIdx].end(), SpanPoint(pbegin));
-                    for(; itspan != spPts[mRefIdx].end() && pend >= itspan->mBpPos; ++itspan){
-                        if(svt == itspan->mSVT){
-                            uint8_t* hpptr = bam_aux_get(b, "HP");
-                            mSpnCnts[itspan->mID].mAltQual.push_back(pairQual);
-                            if(hpptr){
-                                mOpt->libInfo->mIsHaploTagged = true;
-                                int hap = bam_aux2i(hpptr);
-                                if(hap == 1) ++mSpnCnts[itspan->mID].mAlth1;
-                                else ++mSpnCnts[itspan->mID].mAlth2;
-                            }
-                        }
-                    }
-                }
+            while(!ends.empty() && ends.top().first <= pos){
+                active.erase(ends.top().second);
+                ends.pop();
             }
+            if(!active.empty()) mCovCnts[recs[*active.begin()].mID].second += 1;
         }
     }
-    // Compute read counts
+}
+
+void Stats::countReads(const SVSet& svs){
     int32_t lastID = svs.size();
     for(uint32_t id = 0; id < svs.size(); ++id){
         if(svs[id].mSize <= mOpt->filterOpt->mMinInDelSize){
@@ -350,11 +348,78 @@ void Stats::stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& co
             mReadCnts[id].mRightRC = mCovCnts[id + 2 * lastID].second;
         }
     }
-    util::loginfo("Finish gathering coverage information on contig: " + std::string(h->target_name[mRefIdx]), mOpt->logMtx);
-    // Clean-up
-    sam_close(fp);
-    bam_hdr_destroy(h);
-    bam_destroy1(b);
-    hts_itr_destroy(itr);
-    hts_idx_destroy(idx);
+}
+
+void Stats::statPair(const bam1_t* b, uint8_t pairQual, bool pairClip, int32_t refLen, const std::vector<std::vector<CovRecord>>& covRecs, const ContigSpanPoints& spPts){
+    int32_t tid = b->core.tid;
+    // Pair quality
+    if(pairQual < mOpt->filterOpt->mMinGenoQual) return; // Low quality pair
+    // Read-depth fragment counting
+    if(mCountFragments && b->core.tid == b->core.mtid){
+        // Count mid point (fragment counting)
+        int32_t midPos = b->core.pos + bam_cigar2rlen(b->core.n_cigar, bam_get_cigar(b))/2;
+        // Assign fragment counts to SVs
+        for(uint32_t rc = 0; rc < covRecs[tid].size(); ++rc){
+            if(midPos >= covRecs[tid][rc].mStart && midPos < covRecs[tid][rc].mEnd){
+                mCovCnts[covRecs[tid][rc].mID].second += 1;
+                break;
+            }
+        }
+    }
+    // Spanning counting
+    int32_t outerISize = b->core.pos + b->core.l_qseq - b->core.mpos;
+    // Normal spanning pair
+    if((!pairClip) && (DPBamRecord::getSVType(b) == 2) && outerISize >= mOpt->libInfo->mMinNormalISize &&
+       outerISize <= mOpt->libInfo->mMaxNormalISize && b->core.mtid == b->core.tid){
+        // Take 80% of the outersize as the spanned interval
+        int32_t spanlen = 0.8 * outerISize;
+        int32_t pbegin = b->core.mpos;
+        int32_t st = pbegin + 0.1 * outerISize;
+        bool spanvalid = spanAny(spPts[tid], st, std::min(st + spanlen, refLen));
+        if(spanvalid){
+            // Fetch all relevant SVs
+            auto itspan = std::lower_bound(spPts[tid].begin(), spPts[tid].end(), SpanPoint(st));
+            for(; itspan != spPts[tid].end() && (st + spanlen) >= itspan->mBpPos; ++itspan){
+                // Account for reference bias
+                if(refSampled(b, itspan->mID)){
+                    uint8_t* hpptr = bam_aux_get(b, "HP");
+                    mSpnCnts[itspan->mID].mRefQual.push_back(pairQual);
+                    if(hpptr){
+                        mOpt->libInfo->mIsHaploTagged = true;
+                        int hap = bam_aux2i(hpptr);
+                        if(hap == 1) ++mSpnCnts[itspan->mID].mRefh1;
+                        else ++mSpnCnts[itspan->mID].mRefh2;
+                    }
+                }
+            }
+        }
+    }
+    // Abnormal spanning coverage
+    if((DPBamRecord::getSVType(b) != 2) || outerISize < mOpt->libInfo->mMinNormalISize || outerISize > mOpt->libInfo->mMaxNormalISize || b->core.tid != b->core.mtid){
+        std::vector<int32_t> spanIDs;
+        getAbnormalSpans(b, refLen, spPts, spanIDs);
+        for(auto& id: spanIDs) addAltSpan(id, pairQual, getHap(b));
+    }
+}
+
+void Stats::getAbnormalSpans(const bam1_t* b, int32_t refLen, const ContigSpanPoints& spPts, std::vector<int32_t>& spanIDs){
+    int32_t tid = b->core.tid;
+    // Get SV type
+    int32_t svt =  DPBamRecord::getSVType(b, mOpt);
+    if(svt == -1) return;
+    // Spanning a breakpoint?
+    int32_t pbegin = b->core.pos;
+    int32_t pend = std::min(b->core.pos + mOpt->libInfo->mMaxNormalISize, refLen);
+    if(b->core.flag & BAM_FREVERSE){
+        pbegin = std::max(0, b->core.pos + b->core.l_qseq - mOpt->libInfo->mMaxNormalISize);
+        pend = std::min(b->core.pos + b->core.l_qseq, refLen);
+    }
+    bool spanvalid = spanAny(spPts[tid], pbegin, pend);
+    if(spanvalid){
+        // Fetch all relevant SVs
+        auto itspan = std::lower_bound(spPts[tid].begin(), spPts[tid].end(), SpanPoint(pbegin));
+        for(; itspan != spPts[tid].end() && pend >= itspan->mBpPos; ++itspan){
+            if(svt == itspan->mSVT) spanIDs.push_back(itspan->mID);
+        }
+    }
 }
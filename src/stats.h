@@ -12,6 +12,11 @@
 #include "srbamrecord.h"
 #include "dpbamrecord.h"
 #include "alndescriptor.h"
+#include "tile.h"
+#include "region.h"
+#include "onepass.h"
+#include "matejoin.h"
+#include "traspill.h"
 #include <unordered_map>
 #include <htslib/sam.h>
 #include <htslib/faidx.h>
@@ -281,8 +286,13 @@ class Stats{
         std::vector<JunctionCount> mJctCnts;               ///< Single read spanning SV breakpoint stats
         std::vector<SpanningCount> mSpnCnts;               ///< Paired-end read spanning SV breakpoint stats
         std::vector<std::pair<int32_t, int32_t>> mCovCnts; ///< base and fragment coverage count of each SV event
-        std::vector<int32_t> mRefAlignedReadCount;         ///< REF like read count of each SV
-        std::vector<int32_t> mRefAlignedSpanCount;         ///< REF like read pair count of each SV
+        GenomeTile mTile;                                  ///< genomic tile to compute statistics
+        std::unordered_map<size_t, std::pair<uint8_t, bool>> mMates; ///< <hash, <mapq, clip>> of first reads whose mate are beyond this tile
+        std::vector<std::pair<bam1_t*, bool>> mPendingReads;        ///< <second read, clip> whose mate are before this tile
+        const OnePassStore* mStore = NULL;                           ///< records collected in one pass mode to replay instead of reading bam, NULL otherwise
+        bool mCountFragments = true;                                 ///< count fragments of read pairs, false if fragments are counted from mStore
+        std::vector<TraRead> mTraReads;                              ///< reads of inter-chromosomal pairs on this tile, sorted once tile finished
+        TraSpill* mTraSpill = NULL;                                  ///< runs of inter-chromosomal pair reads of merged tiles
 
     public:
         /** Stats constructor */
@@ -291,9 +301,9 @@ class Stats{
         /** Stats constructor
          * @param opt pointer to Options object
          * @param n total SVs to process
-         * @param refidx reference index to compute statistics
+         * @param tile genomic tile to compute statistics
          */
-        Stats(Options* opt, int32_t n, int32_t refidx);
+        Stats(Options* opt, int32_t n, const GenomeTile& tile);
 
         /** Stats constructor
          * @param n total SV number
@@ -301,7 +311,10 @@ class Stats{
         Stats(int32_t n);
 
         /** Stats destructor */
-        ~Stats(){}
+        ~Stats(){
+            for(auto& e: mPendingReads) bam_destroy1(e.first);
+            if(mTraSpill) delete mTraSpill;
+        }
 
         /** create spaces
          * @param n SV total number
@@ -333,22 +346,77 @@ class Stats{
             return os;
         }
 
-        /** gather coverage information of one contig
+        /** gather coverage information of one tile
          * @param svs reference of SVSet(all SVs)
          * @param covRecs coverage records of 3-part of each SV events on each contig
          * @param bpRegs SV breakpoint regions on each contig
          * @param spPts SV DP read mapping position on each contig
-         * @param transQuals translocation reads mapping quality records
-         * @param transClips translocation reads clipping status records
          */
-        void stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& covRecs,  const ContigBpRegions& bpRegs, const ContigSpanPoints& spPts, std::unordered_map<size_t, uint8_t>& transQuals, std::unordered_map<size_t, bool>& transClips);
+        void stat(const SVSet& svs, const std::vector<std::vector<CovRecord>>& covRecs,  const ContigBpRegions& bpRegs, const ContigSpanPoints& spPts);
+
+        /** gather read-count and spanning information of one read pair
+         * @param b pointer to bam1_t struct of the second read in pair
+         * @param pairQual minimum mapping quality of the pair
+         * @param pairClip true if any read of the pair is soft clipped
+         * @param refLen length of contig b mapped to
+         * @param covRecs coverage records of 3-part of each SV events on each contig
+         * @param spPts SV DP read mapping position on each contig
+         */
+        void statPair(const bam1_t* b, uint8_t pairQual, bool pairClip, int32_t refLen, const std::vector<std::vector<CovRecord>>& covRecs, const ContigSpanPoints& spPts);
+
+        /** get SVs whose breakpoint is spanned by an abnormal read pair
+         * @param b pointer to bam1_t struct of the second read in pair
+         * @param refLen length of contig b mapped to
+         * @param spPts SV DP read mapping position on each contig
+         * @param spanIDs vector to store ids of SVs spanned
+         */
+        void getAbnormalSpans(const bam1_t* b, int32_t refLen, const ContigSpanPoints& spPts, std::vector<int32_t>& spanIDs);
+
+        /** get haplotype of an bam record
+         * @param b pointer to bam1_t struct
+         * @return 0 if not tagged, 1 if HP is 1, 2 otherwise
+         */
+        inline static uint8_t getHap(const bam1_t* b){
+            const uint8_t* hpptr = bam_aux_get(b, "HP");
+            if(!hpptr) return 0;
+            return bam_aux2i(hpptr) == 1 ? 1 : 2;
+        }
 
-        /** merge coverage information of all contigs
-         * @param sts reference of list of Stats
-         * @param n number of svs in total
-         * @param return merged stat info
+        /** add one abnormal read pair spanning an SV breakpoint
+         * @param id SV id
+         * @param pairQual minimum mapping quality of the pair
+         * @param hap haplotype of the pair, 0 if not tagged
+         */
+        inline void addAltSpan(int32_t id, uint8_t pairQual, uint8_t hap){
+            mSpnCnts[id].mAltQual.push_back(pairQual);
+            if(hap){
+                mOpt->libInfo->mIsHaploTagged = true;
+                if(hap == 1) ++mSpnCnts[id].mAlth1;
+                else ++mSpnCnts[id].mAlth2;
+            }
+        }
+
+        /** gather information of pairs whose reads are processed in different tiles, including inter-chromosomal pairs joined on disk, must be called after all tiles merged
+         * @param covRecs coverage records of 3-part of each SV events on each contig
+         * @param spPts SV DP read mapping position on each contig
          */
-        static Stats* merge(const std::vector<Stats*>& sts, int32_t n);
+        void statPending(const std::vector<std::vector<CovRecord>>& covRecs, const ContigSpanPoints& spPts);
+
+        /** count fragments recorded in one pass mode, each fragment is assigned to the first coverage record containing its midpoint
+         * @param covRecs coverage records of 3-part of each SV events on each contig, sorted
+         * @param store records collected in one pass mode
+         */
+        void countFragments(const std::vector<std::vector<CovRecord>>& covRecs, const OnePassStore* store);
+
+        /** compute read counts of each SV from coverage counts
+         * @param svs reference of SVSet(all SVs)
+         */
+        void countReads(const SVSet& svs);
+
+        /** merge coverage information of another tile into this Stats
+         * @param other pointer to Stats of another tile
+         */
+        void merge(Stats* other);
 
         /** report BCF format report of all SVs
          * @param svs reference of SVSet
@@ -368,15 +436,50 @@ class Stats{
          */
         uint32_t getAlignmentQual(Matrix2D<char>* alnResult, const uint8_t* qual);
 
+        /** test whether an REF like read(pair) is sampled to account for reference bias, about half of them are sampled\n
+         * decision only depends on read name and SV, so it is irrelevant to tiles and the order reads are visited
+         * @param b pointer to bam1_t struct
+         * @param id SV ID
+         * @return true if sampled
+         */
+        inline static bool refSampled(const bam1_t* b, int32_t id){
+            uint64_t x = svutil::hashString(bam_get_qname(b)) + (uint64_t)id * 0x9e3779b97f4a7c15ULL;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return (x ^ (x >> 31)) & 1;
+        }
+
+        /** test whether any region overlaps with an interval
+         * @param regs sorted and merged regions
+         * @param beg interval starting position
+         * @param end interval ending position(exclusive)
+         * @return true if any region overlaps [beg, end)
+         */
+        inline static bool overlapAny(const std::vector<std::pair<int32_t, int32_t>>& regs, int32_t beg, int32_t end){
+            auto itr = std::upper_bound(regs.begin(), regs.end(), beg, [](int32_t pos, const std::pair<int32_t, int32_t>& reg){return pos < reg.second;});
+            return itr != regs.end() && itr->first < end;
+        }
+
+        /** test whether any spanning point lies in an interval
+         * @param pts SpanPoints sorted by position
+         * @param beg interval starting position
+         * @param end interval ending position(exclusive)
+         * @return true if any SpanPoint lies in [beg, end)
+         */
+        inline static bool spanAny(const std::vector<SpanPoint>& pts, int32_t beg, int32_t end){
+            auto itr = std::lower_bound(pts.begin(), pts.end(), SpanPoint(beg));
+            return itr != pts.end() && itr->mBpPos < end;
+        }
+
         /** test whether an bam record is met for the first time
          * @param b pointer to bam1_t struct
-         * @param lastAlignedReads set of reads mapped at last position
+         * @param lastAlignedReads reads mapped at last position
          * @return true if b is met for the first time
          */
-        inline static bool firstInPair(bam1_t* b, std::set<size_t>& lastAlignedReads){
+        inline static bool firstInPair(bam1_t* b, const SamePosReads& lastAlignedReads){
             if(b->core.tid == b->core.mtid){
                 return (b->core.pos < b->core.mpos) ||
-                       (b->core.pos == b->core.mpos && lastAlignedReads.find(svutil::hashString(bam_get_qname(b))) == lastAlignedReads.end());
+                       (b->core.pos == b->core.mpos && !lastAlignedReads.contains(svutil::hashString(bam_get_qname(b))));
             }else return b->core.tid < b->core.mtid;
         }
 };
@@ -1,7 +1,11 @@
+#ifndef STATUTIL_H
+#define STATUTIL_H
+
 #include <map>
 #include <cmath>
 #include <vector>
 #include <numeric>
+#include <cstdint>
 #include <algorithm>
 #include <unordered_map>
 
@@ -185,4 +189,74 @@ namespace statutil{
         return median(absDev);
     }
 
+    /** class to store histogram of bounded non-negative integers\n
+     * values larger than the bound are counted in the last bin, so median and MAD\n
+     * are exact as long as they are smaller than the bound
+     */
+    class Histogram{
+        public:
+            std::vector<uint64_t> mCounts; ///< count of each value in [0, bound]
+            uint64_t mTotal;               ///< total values counted
+
+        public:
+            /** Histogram constructor
+             * @param bound maximum value counted in its own bin
+             */
+            Histogram(int32_t bound){
+                mCounts.resize(bound + 1, 0);
+                mTotal = 0;
+            }
+
+            /** Histogram destructor */
+            ~Histogram(){}
+
+            /** count one value
+             * @param v value to count
+             */
+            inline void add(int32_t v){
+                ++mCounts[std::min(std::max(v, 0), (int32_t)mCounts.size() - 1)];
+                ++mTotal;
+            }
+
+            /** count all values of another histogram
+             * @param other reference of another Histogram with the same bound
+             */
+            inline void merge(const Histogram& other){
+                for(uint32_t i = 0; i < mCounts.size(); ++i) mCounts[i] += other.mCounts[i];
+                mTotal += other.mTotal;
+            }
+
+            /** get median of values counted, same as median() of all values
+             * @return median of values counted, 0 if no value counted
+             */
+            inline int32_t median() const {
+                if(mTotal == 0) return 0;
+                uint64_t rank = mTotal / 2;
+                uint64_t cum = 0;
+                for(uint32_t i = 0; i < mCounts.size(); ++i){
+                    cum += mCounts[i];
+                    if(cum > rank) return i;
+                }
+                return mCounts.size() - 1;
+            }
+
+            /** get MAD of values counted, same as mad() of all values
+             * @param m median of values counted
+             * @return mad of values counted, 0 if no value counted
+             */
+            inline int32_t mad(int32_t m) const {
+                if(mTotal == 0) return 0;
+                uint64_t rank = mTotal / 2;
+                uint64_t cum = 0;
+                int32_t bound = mCounts.size();
+                for(int32_t d = 0; m - d >= 0 || m + d < bound; ++d){
+                    if(m - d >= 0 && m - d < bound) cum += mCounts[m - d];
+                    if(d > 0 && m + d >= 0 && m + d < bound) cum += mCounts[m + d];
+                    if(cum > rank) return d;
+                }
+                return bound - 1;
+            }
+    };
 }
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef SUBSAMPLE_H
+#define SUBSAMPLE_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+/** class to store one dense region found and subsampled */
+struct DenseRegion{
+    int32_t mBeg;    ///< smallest position of records in region
+    int32_t mEnd;    ///< largest position of records in region
+    size_t mRecords; ///< records in region
+    size_t mDropped; ///< records dropped from region
+};
+
+/** class to subsample evidence records in hyper-dense windows before clustering\n
+ * a region is dense if some window of it holds more than a limited number of records,\n
+ * records of each dense region are reservoir sampled with a generator seeded by the region itself,\n
+ * so the records kept are irrelevant to threads used and the order records are clustered
+ */
+class DenseSampler{
+    public:
+        /** subsample dense regions of records sorted by position in [beg, end)\n
+         * records kept are moved to [beg, returned index) in their original order, records dropped are moved after them
+         * @param recs records to subsample
+         * @param beg index of the first record
+         * @param end index past the last record
+         * @param pos functor to get position of one record
+         * @param window size of window to count records in
+         * @param maxDensity maximum records allowed in one window
+         * @param seed seed of generator, combined with region position
+         * @param regions vector to append dense regions found
+         * @return index past the last record kept
+         */
+        template<typename T, typename PosFn>
+        static size_t subsample(std::vector<T>& recs, size_t beg, size_t end, PosFn pos, int32_t window, int32_t maxDensity, uint64_t seed, std::vector<DenseRegion>& regions){
+            if(end - beg <= (size_t)maxDensity) return end;
+            // Find dense regions, each is the union of overlapping windows holding more than maxDensity records
+            std::vector<std::pair<size_t, size_t>> dense; // <first, last> index of each dense region
+            std::vector<size_t> peaks;                     // maximum records in one window of each dense region
+            size_t denseEnd = beg;
+            for(size_t i = beg, j = beg; i < end; ++i){
+                if(j < i) j = i;
+                while(j < end && pos(recs[j]) - pos(recs[i]) <= window) ++j;
+                if(j - i <= (size_t)maxDensity) continue;
+                if(dense.empty() || i >= denseEnd){
+                    dense.push_back(std::make_pair(i, j));
+                    peaks.push_back(j - i);
+                }else{
+                    dense.back().second = std::max(dense.back().second, j);
+                    peaks.back() = std::max(peaks.back(), j - i);
+                }
+                denseEnd = std::max(denseEnd, j);
+            }
+            if(dense.empty()) return end;
+            // Reservoir sample each dense region, keep its density at peak window down to maxDensity
+            std::vector<bool> keep(end - beg, true);
+            std::vector<size_t> reservoir;
+            for(uint32_t r = 0; r < dense.size(); ++r){
+                size_t n = dense[r].second - dense[r].first;
+                size_t k = std::max((size_t)maxDensity, (size_t)((double)n * maxDensity / peaks[r]));
+                if(k >= n) continue;
+                uint64_t state = seed ^ ((uint64_t)(uint32_t)pos(recs[dense[r].first]) << 20);
+                reservoir.resize(k);
+                for(size_t t = 0; t < k; ++t) reservoir[t] = t;
+                for(size_t t = k; t < n; ++t){
+                    size_t x = nextRandom(state) % (t + 1);
+                    if(x < k) reservoir[x] = t;
+                }
+                for(size_t t = 0; t < n; ++t) keep[dense[r].first - beg + t] = false;
+                for(auto& t: reservoir) keep[dense[r].first - beg + t] = true;
+                DenseRegion dr;
+                dr.mBeg = pos(recs[dense[r].first]);
+                dr.mEnd = pos(recs[dense[r].second - 1]);
+                dr.mRecords = n;
+                dr.mDropped = n - k;
+                regions.push_back(dr);
+            }
+            // Move records kept forward
+            std::vector<T> dropped;
+            size_t kept = beg;
+            for(size_t i = beg; i < end; ++i){
+                if(keep[i - beg]) recs[kept++] = recs[i];
+                else dropped.push_back(recs[i]);
+            }
+            std::copy(dropped.begin(), dropped.end(), recs.begin() + kept);
+            return kept;
+        }
+
+    private:
+        /** get next value of an splitmix64 generator
+         * @param state state of generator
+         * @return next value
+         */
+        inline static uint64_t nextRandom(uint64_t& state){
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+};
+
+#endif
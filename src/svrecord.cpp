@@ -128,11 +128,11 @@ bool SVRecord::consensusRefAlign(Matrix2D<char>* alnResult){
     }
 }
 
-bool SVRecord::refineSRBp(const Options* opt, const bam_hdr_t* hdr, const char* chr1Seq, const char* chr2Seq){
+bool SVRecord::refineSRBp(const Options* opt, const bam_hdr_t* hdr){
     if((int32_t)mConsensus.size() < 2 * opt->filterOpt->mMinFlankSize) return false;
     // Get reference slice
     BreakPoint bp = BreakPoint(*this, hdr);
-    mSVRef = bp.getSVRef(chr1Seq, chr2Seq);
+    mSVRef = bp.getSVRef(opt->refStore, hdr);
     // SR consensus to mSVRef alignment
     Matrix2D<char>* alnResult = new Matrix2D<char>();
     if(!consensusRefAlign(alnResult)){
@@ -271,20 +271,16 @@ void mergeAndSortSVSet(SVSet& sr, SVSet& pe, int32_t peMergeSearchWindow, int32_
 void getDPSVRef(SVSet& pe, Options* opt){
     // Open file handler
     samFile* fp = sam_open(opt->bamfile.c_str(), "r");
+    opt->attachThreadPool(fp);
     hts_set_fai_filename(fp, opt->genome.c_str());
     bam_hdr_t* h = sam_hdr_read(fp);
-    faidx_t* fai = fai_load(opt->genome.c_str());
     // get SVRef on same chr
     for(auto sviter = pe.begin(); sviter != pe.end(); ++sviter){
         if(sviter->mPrecise) continue;
         sviter->mNameChr1 = h->target_name[sviter->mChr1];
         sviter->mNameChr2 = h->target_name[sviter->mChr2];
-        int32_t chrLen = -1;
-        char* chrSeq = faidx_fetch_seq(fai, h->target_name[sviter->mChr1],  sviter->mSVStart - 1, sviter->mSVStart - 1, &chrLen);
-        sviter->mSVRef = std::string(1, std::toupper(chrSeq[0]));
-        free(chrSeq);
+        sviter->mSVRef = opt->refStore->slice(h->target_name[sviter->mChr1], sviter->mSVStart - 1, sviter->mSVStart);
     }
     sam_close(fp);
     bam_hdr_destroy(h);
-    fai_destroy(fai);
 }
@@ -102,11 +102,9 @@ class SVRecord{
         /** align consensus SR seq to constructed SV ref seq to refine breakpoint coordinate
          * @param opt pointer to Options object
          * @param hdr bam header
-         * @param chr1Seq little chr sequence
-         * @param chr2Seq larger chr sequence
          * @return true if breakpoint refined
          */
-        bool refineSRBp(const Options* opt, const bam_hdr_t* hdr, const char* chr1Seq, const char* chr2Seq = NULL);
+        bool refineSRBp(const Options* opt, const bam_hdr_t* hdr);
         
         /** align consensus SR seq to constructed SV ref seq by split alignment strategy
          * @param alnResult to storealignment result
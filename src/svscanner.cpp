@@ -1,90 +1,72 @@
 #include "svutil.h"
 #include "svscanner.h"
+#include "ThreadPool.h"
 
 void SVScanner::scanDPandSR(){
-    // Open file handles
-    samFile* fp = sam_open(mOpt->bamfile.c_str(), "r");
-    hts_idx_t* idx = sam_index_load(fp, mOpt->bamfile.c_str());
-    hts_set_fai_filename(fp, mOpt->genome.c_str());
-    bam_hdr_t* h = sam_hdr_read(fp);
-    bam1_t* b = bam_init1();
-    // Split-read records
+    util::loginfo("Start scanning bam for SRs and DPs");
+    // Scan tiles of valid regions in parallel
+    TileList tiles = TileScheduler::split(mValidRegs, mOpt->tileSize);
+    util::loginfo("Valid regions split into " + std::to_string(tiles.size()) + " tiles");
+    ThreadPool::ThreadPool pool(std::max(1, std::min(mOpt->nthread, (int32_t)tiles.size())));
+    std::vector<TileEvidence*> tileEvis(tiles.size(), NULL);
+    std::vector<std::future<void>> scanRets(tiles.size());
+    uint32_t maxTask = 2 * mOpt->nthread;
+    uint32_t nextTile = 0;
+    // Merge evidences in tile order, so the result is irrelevant to threads used
     JunctionMap* jctMap = new JunctionMap(mOpt);
-    const uint16_t BAM_SRSKIP_MASK = (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY);
-    // DP-read records
+    SRBamRecordSet* streamSRs = mOpt->streamSR ? new SRBamRecordSet(mOpt) : NULL;
     DPBamRecordSet* dprSet = new DPBamRecordSet(mOpt);
-    const uint16_t BAM_DPSKIP_MASK = (BAM_FSUPPLEMENTARY | BAM_FMUNMAP);
-    // Inter-chromosomal mate map and alignment length
-    std::unordered_map<size_t, std::pair<uint8_t, int32_t>> matetra;
-    std::unordered_map<size_t, std::pair<uint8_t, int32_t>> matemap;
-    util::loginfo("Start scanning bam for SRs and DPs");
-    // Iterate bam contig by contig
-    for(int32_t refIndex = 0; refIndex < h->n_targets; ++refIndex){
-        if(mValidRegs[refIndex].empty()) continue; // Skip invalid contig
-        uint64_t mapped = 0;
-        uint64_t unmapped = 0;
-        hts_idx_get_stat(idx, refIndex, &mapped, &unmapped);
-        if(!mapped) continue; // Skip contig without any mapped reads
-        // Iterate all read alignments on this contig and valid regions
-        for(auto regit = mValidRegs[refIndex].begin(); regit != mValidRegs[refIndex].end(); ++regit){
-            hts_itr_t* itr = sam_itr_queryi(idx, refIndex, regit->first, regit->second);
-            int32_t lastAlignedPos = 0;
-            std::set<size_t> lastAlignedPosReads;
-            while(sam_itr_next(fp, itr, b) >= 0){
-                if(b->core.flag & BAM_SRSKIP_MASK) continue;// skip invalid reads
-                if(b->core.qual < mOpt->filterOpt->minMapQual || b->core.tid < 0) continue;// skip quality poor read
-                // Try to parse and insert an SR bam record
-                if(jctMap->insertJunction(b)) mOpt->svRefID.insert(b->core.tid);
-                // DP parsing
-                if(mOpt->libInfo->mMedian == 0) continue; // skip SE library
-                if(b->core.flag & BAM_DPSKIP_MASK) continue;// skip invalid reads
-                if(mValidRegs[b->core.mtid].empty()) continue;// skip invalid regions
-                if(b->core.tid != b->core.mtid && b->core.qual < mOpt->filterOpt->mMinTraQual) continue;// skip quality poor read
-                int32_t svt = DPBamRecord::getSVType(b, mOpt);// get sv type
-                if(svt == -1) continue; // Skip PE which does not support any SV
-                if(mOpt->SVTSet.find(svt) == mOpt->SVTSet.end()) continue;// Skip SV type which does not needed to called
-                if(b->core.pos > lastAlignedPos){// clear records aligned at the same position
-                    lastAlignedPosReads.clear();
-                    lastAlignedPos = b->core.pos;
-                }
-                if(Stats::firstInPair(b, lastAlignedPosReads)){// First in pair
-                    size_t hv = svutil::hashPairCurr(b);
-                    lastAlignedPosReads.insert(hv);
-                    if(svt >= 5) matetra[hv] = std::make_pair(b->core.qual, bam_cigar2rlen(b->core.n_cigar, bam_get_cigar(b)));
-                    else matemap[hv] = std::make_pair(b->core.qual, bam_cigar2rlen(b->core.n_cigar, bam_get_cigar(b)));
-                }else{// Second in pair
-                    size_t hv = svutil::hashPairMate(b);
-                    int32_t matealn = 0;
-                    uint8_t pairQual = 0;
-                    if(svt >= 5){// translocation
-                        auto mit = matetra.find(hv);
-                        if(mit == matetra.end()) continue; // Skip read whose mate discarded
-                        if(mit->second.first == 0) continue; // Skip read whose mate is mapped to multiple place
-                        pairQual = std::min(mit->second.first, b->core.qual);
-                        matealn = mit->second.second;
-                        mit->second.first = 0;
-                    }else{// sv on same chr
-                        auto mit = matemap.find(hv);
-                        if(mit == matemap.end()) continue; // Skip read whose mate discarded
-                        if(mit->second.first == 0) continue; // Skip read whose mate is mapped to multiple place
-                        pairQual = std::min(mit->second.first, b->core.qual);
-                        matealn = mit->second.second;
-                        mit->second.first = 0;
-                    }
-                    dprSet->insertDP(b, matealn, pairQual, svt);
-                    mOpt->svRefID.insert(b->core.tid);
-                    mOpt->svRefID.insert(b->core.mtid);
-                    ++mOpt->libInfo->mAbnormalPairs;
-                }
-            }
-            hts_itr_destroy(itr);
+    // First reads whose mate are on later tiles, dropped once all tiles before their mate merged
+    MateJoinTable<std::pair<uint8_t, int32_t>> matemap;
+    std::vector<PendingDP> joinedDPs;
+    if(mOpt->onePass) mStore = new OnePassStore(mOpt, tiles);
+    for(uint32_t i = 0; i < tiles.size(); ++i){
+        for(; nextTile < tiles.size() && nextTile < i + maxTask; ++nextTile){
+            tileEvis[nextTile] = new TileEvidence(mOpt, tiles[nextTile]);
+            scanRets[nextTile] = pool.enqueue(&SVScanner::scanTile, this, tileEvis[nextTile]);
+        }
+        scanRets[i].get();
+        TileEvidence* te = tileEvis[i];
+        if(streamSRs) streamSRs->merge(te->mSRSet, jctMap->mReadStore.size());
+        jctMap->merge(te->mJctMap);
+        dprSet->merge(te->mDPSet);
+        mOpt->svRefID.insert(te->mSVRefID.begin(), te->mSVRefID.end());
+        mOpt->libInfo->mAbnormalPairs += te->mAbnormalPairs;
+        // Join pairs across tiles, mates of second reads on this tile are all on merged tiles
+        for(auto& r: te->mPendingDPs){
+            std::pair<uint8_t, int32_t>* mit = matemap.find(r.mHash);
+            if(!mit) continue; // Skip read whose mate discarded
+            if(mit->first == 0) continue; // Skip read whose mate is mapped to multiple place
+            r.mDP.mMapQual = std::min(mit->first, r.mDP.mMapQual);
+            r.mDP.mMateAlen = mit->second;
+            mit->first = 0;
+            joinedDPs.push_back(r);
         }
-        util::loginfo("Contig: " + std::string(h->target_name[refIndex]) + " finished SR and DP scanning");
+        matemap.evict(MateJoinTable<std::pair<uint8_t, int32_t>>::locus(te->mTile.mTid, te->mTile.mEnd));
+        for(auto& m: te->mMates) matemap.insert(m);
+        if(mStore) mStore->merge(te->mCollector);
+        delete te;
+        tileEvis[i] = NULL;
     }
-    bam_destroy1(b);
+    // Pairs joined across tiles are appended after all tiles merged
+    for(auto& r: joinedDPs){
+        dprSet->mDPs[r.mSVT].push_back(r.mDP);
+        mOpt->svRefID.insert(r.mDP.mCurTid);
+        mOpt->svRefID.insert(r.mDP.mMateTid);
+        ++mOpt->libInfo->mAbnormalPairs;
+    }
+    if(mStore) mStore->finish();
     // Process all SRs
     util::loginfo("Finish scanning bam for SRs and DPs");
     SRBamRecordSet srs(mOpt, jctMap);
+    if(streamSRs){
+        size_t streamed = 0;
+        for(auto& e: streamSRs->mSRs) streamed += e.size();
+        util::loginfo("SRs classified while scanning: " + std::to_string(streamed));
+        srs.merge(streamSRs, 0);
+        delete streamSRs;
+    }
+    srs.releaseReads();
     util::loginfo("Start clustering SRs");
     srs.cluster(mSRSVs);
     util::loginfo("Finish clustering SRs");
@@ -109,7 +91,7 @@ void SVScanner::scanDPandSR(){
     // Annotate junction reads and spaning coverage
     util::loginfo("Start annotating SV coverage");
     Annotator* covAnn = new Annotator(mOpt);
-    Stats* covStat = covAnn->covAnnotate(mDPSVs);
+    Stats* covStat = covAnn->covAnnotate(mDPSVs, mStore);
     util::loginfo("Finish annotating SV coverage");
     util::loginfo("Start writing SVs to BCF file");
     covStat->reportBCF(mDPSVs);
@@ -123,4 +105,90 @@ void SVScanner::scanDPandSR(){
     util::loginfo("Finish writing SVs to TSV file");
     delete covAnn;
     delete covStat;
+    if(mStore){
+        delete mStore;
+        mStore = NULL;
+    }
+}
+
+void SVScanner::scanTile(TileEvidence* te){
+    // Open file handles
+    samFile* fp = sam_open(mOpt->bamfile.c_str(), "r");
+    mOpt->attachThreadPool(fp);
+    hts_idx_t* idx = sam_index_load(fp, mOpt->bamfile.c_str());
+    hts_set_fai_filename(fp, mOpt->genome.c_str());
+    bam_hdr_t* h = sam_hdr_read(fp);
+    const GenomeTile& tile = te->mTile;
+    uint64_t mapped = 0;
+    uint64_t unmapped = 0;
+    hts_idx_get_stat(idx, tile.mTid, &mapped, &unmapped);
+    if(!mapped){// Skip contig without any mapped reads
+        sam_close(fp);
+        hts_idx_destroy(idx);
+        bam_hdr_destroy(h);
+        return;
+    }
+    bam1_t* b = bam_init1();
+    const uint16_t BAM_SRSKIP_MASK = (BAM_FQCFAIL | BAM_FDUP | BAM_FUNMAP | BAM_FSECONDARY);
+    const uint16_t BAM_DPSKIP_MASK = (BAM_FSUPPLEMENTARY | BAM_FMUNMAP);
+    // Mapping quality and alignment length of first reads whose mate are on this tile, dropped once scan passes their mate
+    MateJoinTable<std::pair<uint8_t, int32_t>> matemap;
+    // Iterate all read alignments starting in this tile, reads around this tile are also needed to collect reads in one pass mode
+    int32_t context = te->mCollector ? te->mCollector->mContext : 0;
+    hts_itr_t* itr = sam_itr_queryi(idx, tile.mTid, std::max(0, tile.mBeg - context), std::min((int32_t)h->target_len[tile.mTid], tile.mEnd + context));
+    SamePosReads lastAlignedPosReads;
+    std::vector<SplitPart> saParts;
+    std::vector<Junction> jcts;
+    while(sam_itr_next(fp, itr, b) >= 0){
+        if(te->mCollector) te->mCollector->collect(b);
+        if(!tile.owns(b) || b->core.pos >= tile.mEnd) continue; // skip reads processed by other tiles
+        matemap.evict(MateJoinTable<std::pair<uint8_t, int32_t>>::locus(b->core.tid, b->core.pos));
+        if(b->core.flag & BAM_SRSKIP_MASK) continue;// skip invalid reads
+        if(b->core.qual < mOpt->filterOpt->minMapQual || b->core.tid < 0) continue;// skip quality poor read
+        // Try to parse and insert an SR bam record
+        if(te->mSRSet && te->mJctMap->parseSA(b, h, saParts)){
+            // All split parts are known from primary read, classify it at once and skip its supplementary records
+            if(!(b->core.flag & BAM_FSUPPLEMENTARY) && te->mJctMap->getSplitJunctions(b, saParts, jcts)){
+                te->mSRSet->classifyRead(jcts.data(), jcts.size());
+                for(auto& jct: jcts) te->mSVRefID.insert(jct.mRefidx);
+            }
+        }else if(te->mJctMap->insertJunction(b)) te->mSVRefID.insert(b->core.tid);
+        // DP parsing
+        if(mOpt->libInfo->mMedian == 0) continue; // skip SE library
+        if(b->core.flag & BAM_DPSKIP_MASK) continue;// skip invalid reads
+        if(mValidRegs[b->core.mtid].empty()) continue;// skip invalid regions
+        if(b->core.tid != b->core.mtid && b->core.qual < mOpt->filterOpt->mMinTraQual) continue;// skip quality poor read
+        int32_t svt = DPBamRecord::getSVType(b, mOpt);// get sv type
+        if(svt == -1) continue; // Skip PE which does not support any SV
+        if(mOpt->SVTSet.find(svt) == mOpt->SVTSet.end()) continue;// Skip SV type which does not needed to called
+        lastAlignedPosReads.advance(b->core.pos);// clear records aligned at the same position
+        if(Stats::firstInPair(b, lastAlignedPosReads)){// First in pair
+            size_t hv = svutil::hashPairCurr(b);
+            lastAlignedPosReads.add(svutil::hashString(bam_get_qname(b)));
+            if(b->core.tid != b->core.mtid || tile.mateAfter(b)) te->mMates.push_back(MateEntry<std::pair<uint8_t, int32_t>>(hv, MateJoinTable<std::pair<uint8_t, int32_t>>::locus(b->core.mtid, b->core.mpos), std::make_pair(b->core.qual, bam_cigar2rlen(b->core.n_cigar, bam_get_cigar(b)))));
+            else matemap.insert(hv, MateJoinTable<std::pair<uint8_t, int32_t>>::locus(b->core.mtid, b->core.mpos), std::make_pair(b->core.qual, bam_cigar2rlen(b->core.n_cigar, bam_get_cigar(b))));
+        }else{// Second in pair
+            size_t hv = svutil::hashPairMate(b);
+            if(b->core.tid != b->core.mtid || tile.mateBefore(b)){// mate will be joined after all tiles scanned
+                te->mPendingDPs.push_back(PendingDP(hv, svt, DPBamRecord(b, 0, b->core.qual)));
+                continue;
+            }
+            std::pair<uint8_t, int32_t>* mit = matemap.find(hv);
+            if(!mit) continue; // Skip read whose mate discarded
+            if(mit->first == 0) continue; // Skip read whose mate is mapped to multiple place
+            uint8_t pairQual = std::min(mit->first, b->core.qual);
+            int32_t matealn = mit->second;
+            mit->first = 0;
+            te->mDPSet->insertDP(b, matealn, pairQual, svt);
+            te->mSVRefID.insert(b->core.tid);
+            ++te->mAbnormalPairs;
+        }
+    }
+    if(te->mCollector) te->mCollector->finish();
+    util::loginfo("Tile: " + std::string(h->target_name[tile.mTid]) + ":" + std::to_string(tile.mBeg) + "-" + std::to_string(tile.mEnd) + " finished SR and DP scanning", mOpt->logMtx);
+    hts_itr_destroy(itr);
+    bam_destroy1(b);
+    sam_close(fp);
+    hts_idx_destroy(idx);
+    bam_hdr_destroy(h);
 }
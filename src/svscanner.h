@@ -6,9 +6,64 @@
 #include "srbamrecord.h"
 #include "svrecord.h"
 #include "options.h"
+#include "tile.h"
+#include "onepass.h"
+#include "matejoin.h"
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <map>
+#include <set>
+
+/** class to store the second read of an DP whose first read is on an earlier tile */
+struct PendingDP{
+    size_t mHash;    ///< hash of the pair
+    int32_t mSVT;    ///< SV type the DP supports
+    DPBamRecord mDP; ///< DP whose mate information is filled once joined
+
+    /** PendingDP constructor
+     * @param hash hash of the pair
+     * @param svt SV type the DP supports
+     * @param dp DP whose mate information is not filled
+     */
+    PendingDP(size_t hash, int32_t svt, const DPBamRecord& dp) : mHash(hash), mSVT(svt), mDP(dp) {}
+};
+
+/** class to store SR and DP evidences found by scanning one tile */
+class TileEvidence{
+    public:
+        GenomeTile mTile;                                                   ///< tile scanned
+        JunctionMap* mJctMap;                                               ///< junction reads found on this tile
+        SRBamRecordSet* mSRSet;                                             ///< SRs classified from reads whose split parts are all known from SA tag, NULL if not streaming
+        DPBamRecordSet* mDPSet;                                             ///< DPs whose both reads are on this tile
+        std::set<int32_t> mSVRefID;                                         ///< SV occuring reference id found on this tile
+        int32_t mAbnormalPairs;                                             ///< abnormal read pairs found on this tile
+        std::vector<MateEntry<std::pair<uint8_t, int32_t>>> mMates;         ///< <mapq, alnlen> of first reads whose mate are beyond this tile
+        std::vector<PendingDP> mPendingDPs;                                 ///< second reads whose mate are before this tile
+        TileCollector* mCollector;                                          ///< records collected for later stages in one pass mode, NULL otherwise
+
+    public:
+        /** TileEvidence constructor
+         * @param opt pointer to Options
+         * @param tile tile to scan
+         */
+        TileEvidence(Options* opt, const GenomeTile& tile){
+            mTile = tile;
+            mJctMap = new JunctionMap(opt);
+            mSRSet = opt->streamSR ? new SRBamRecordSet(opt) : NULL;
+            mDPSet = new DPBamRecordSet(opt);
+            mAbnormalPairs = 0;
+            mCollector = opt->onePass ? new TileCollector(opt, tile) : NULL;
+        }
+
+        /** TileEvidence destructor */
+        ~TileEvidence(){
+            delete mJctMap;
+            if(mSRSet) delete mSRSet;
+            delete mDPSet;
+            if(mCollector) delete mCollector;
+        }
+};
 
 /** class to scan sv */
 class SVScanner{
@@ -17,7 +72,7 @@ class SVScanner{
         RegionList mValidRegs; ///< valid regions to scan for SV
         SVSet mDPSVs;          ///< DP supported SV records
         SVSet mSRSVs;          ///< SR supported SVrecords
-        ContigSRs mCtgSRs;     ///< SR supporting SV on each contig
+        OnePassStore* mStore;  ///< records collected for assembly and genotyping in one pass mode, NULL otherwise
 
     public:
         /** SVScanner constructor
@@ -26,13 +81,21 @@ class SVScanner{
         SVScanner(Options* opt){
             mOpt = opt;
             mValidRegs = opt->validRegions;
+            mStore = NULL;
         }
 
         /** SVScanner destructor */
-        ~SVScanner(){}
+        ~SVScanner(){
+            if(mStore) delete mStore;
+        }
 
         /** scan bam for DP and SR supporting SVs */
         void scanDPandSR();
+
+        /** scan one tile for DP and SR evidences, pairs whose mate are not on this tile are left to be joined after all tiles finished
+         * @param te pointer to TileEvidence to store the evidences of one tile
+         */
+        void scanTile(TileEvidence* te);
 };
 
 #endif
@@ -0,0 +1,104 @@
+#ifndef TILE_H
+#define TILE_H
+
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <htslib/sam.h>
+#include "options.h"
+
+/** class to store an genomic window which is processed as an independent task\n
+ * bam records overlapping [mBeg, mEnd) are fetched, but only those starting at or after mOwnBeg\n
+ * are processed, so each record is processed by exactly one tile
+ */
+struct GenomeTile{
+    int32_t mTid = -1;   ///< reference id of tile
+    int32_t mBeg = 0;    ///< starting position of tile on reference
+    int32_t mEnd = 0;    ///< ending position of tile on reference(exclusive)
+    int32_t mOwnBeg = 0; ///< records starting at or after this position on reference are owned by this tile
+    int32_t mIdx = 0;    ///< index of this tile in all tiles
+
+    /** GenomeTile constructor */
+    GenomeTile(){}
+
+    /** GenomeTile constructor
+     * @param tid reference id of tile
+     * @param beg starting position of tile on reference
+     * @param end ending position of tile on reference(exclusive)
+     * @param ownBeg records starting at or after this position on reference are owned by this tile
+     * @param idx index of this tile in all tiles
+     */
+    GenomeTile(int32_t tid, int32_t beg, int32_t end, int32_t ownBeg, int32_t idx) : mTid(tid), mBeg(beg), mEnd(end), mOwnBeg(ownBeg), mIdx(idx) {}
+
+    /** GenomeTile destructor */
+    ~GenomeTile(){}
+
+    /** test whether an bam record fetched by this tile should be processed by this tile
+     * @param b pointer to bam1_t struct fetched from [mBeg, mEnd)
+     * @return true if b is owned by this tile
+     */
+    inline bool owns(const bam1_t* b) const {
+        return b->core.pos >= mOwnBeg;
+    }
+
+    /** test whether the mate of an bam record on the same contig is fetched by an earlier tile
+     * @param b pointer to bam1_t struct owned by this tile
+     * @return true if mate of b is owned by an earlier tile
+     */
+    inline bool mateBefore(const bam1_t* b) const {
+        return b->core.mtid == mTid && b->core.mpos < mOwnBeg;
+    }
+
+    /** test whether the mate of an bam record on the same contig is fetched by an later tile
+     * @param b pointer to bam1_t struct owned by this tile
+     * @return true if mate of b is owned by an later tile
+     */
+    inline bool mateAfter(const bam1_t* b) const {
+        return b->core.mtid == mTid && b->core.mpos >= mEnd;
+    }
+
+    /** operator to output an GenomeTile to ostream
+     * @param os reference of ostream
+     * @param t reference of GenomeTile
+     * @return reference of ostream
+     */
+    inline friend std::ostream& operator<<(std::ostream& os, const GenomeTile& t){
+        os << t.mTid << ":" << t.mBeg << "-" << t.mEnd << "(" << t.mOwnBeg << ")";
+        return os;
+    }
+};
+
+/** type to store a list of GenomeTile */
+typedef std::vector<GenomeTile> TileList;
+
+/** class to split regions into fixed size tiles */
+class TileScheduler{
+    public:
+        /** split regions into tiles of at most tileSize basepairs\n
+         * tiles are ordered by contig and position, reads starting in the gap between two regions\n
+         * belong to the first tile of the latter region
+         * @param regs regions on each contig, regions of each contig are non-overlapping
+         * @param tileSize maximum length of each tile
+         * @return list of tiles
+         */
+        inline static TileList split(const RegionList& regs, int32_t tileSize){
+            TileList tiles;
+            tileSize = std::max(1, tileSize);
+            for(int32_t tid = 0; tid < (int32_t)regs.size(); ++tid){
+                int32_t lastEnd = 0;
+                for(auto& reg: regs[tid]){
+                    int32_t ownBeg = lastEnd;
+                    for(int32_t beg = reg.first; beg < reg.second; beg += tileSize){
+                        int32_t end = std::min(reg.second, beg + tileSize);
+                        tiles.push_back(GenomeTile(tid, beg, end, std::max(ownBeg, 0), tiles.size()));
+                        ownBeg = end;
+                    }
+                    lastEnd = std::max(lastEnd, reg.second);
+                }
+            }
+            return tiles;
+        }
+};
+
+#endif
@@ -0,0 +1,58 @@
+#include "traspill.h"
+
+void TraSpill::addRun(std::vector<TraRead>& reads){
+    if(reads.empty()) return;
+    if(!mFp){
+        mFp = tmpfile();
+        if(!mFp) util::errorExit("Failed to create temporary file for joining translocation pairs");
+    }
+    fseeko(mFp, 0, SEEK_END);
+    uint64_t offset = ftello(mFp);
+    if(fwrite(reads.data(), sizeof(TraRead), reads.size(), mFp) != reads.size()){
+        util::errorExit("Failed to write temporary file for joining translocation pairs");
+    }
+    mRuns.push_back(std::make_pair(offset, (uint64_t)reads.size()));
+    std::vector<TraRead>().swap(reads);
+}
+
+void TraSpill::rewind(){
+    mCursors.clear();
+    mCursors.resize(mRuns.size());
+    std::priority_queue<HeapItem, std::vector<HeapItem>, HeapGreater>().swap(mHeap);
+    if(mFp) fflush(mFp);
+    for(uint32_t i = 0; i < mRuns.size(); ++i){
+        mCursors[i].mOffset = mRuns[i].first;
+        mCursors[i].mLeft = mRuns[i].second;
+        mCursors[i].mIdx = 0;
+        if(load(i)) mHeap.push(std::make_pair(mCursors[i].mBuf[0], i));
+    }
+}
+
+bool TraSpill::next(TraRead& r){
+    if(mHeap.empty()) return false;
+    r = mHeap.top().first;
+    uint32_t i = mHeap.top().second;
+    mHeap.pop();
+    RunCursor& c = mCursors[i];
+    if(++c.mIdx < c.mBuf.size() || load(i)) mHeap.push(std::make_pair(c.mBuf[c.mIdx], i));
+    return true;
+}
+
+bool TraSpill::load(uint32_t i){
+    const uint64_t chunk = 4096;
+    RunCursor& c = mCursors[i];
+    uint64_t n = std::min(chunk, c.mLeft);
+    if(n == 0){
+        std::vector<TraRead>().swap(c.mBuf);
+        return false;
+    }
+    c.mBuf.resize(n);
+    fseeko(mFp, c.mOffset, SEEK_SET);
+    if(fread(c.mBuf.data(), sizeof(TraRead), n, mFp) != n){
+        util::errorExit("Failed to read temporary file for joining translocation pairs");
+    }
+    c.mOffset += n * sizeof(TraRead);
+    c.mLeft -= n;
+    c.mIdx = 0;
+    return true;
+}
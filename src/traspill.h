@@ -0,0 +1,112 @@
+#ifndef TRASPILL_H
+#define TRASPILL_H
+
+#include <queue>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include "util.h"
+
+/** class to store one read of an inter-chromosomal pair to be joined on disk\n
+ * clipping status is not stored as it only matters to normal spanning pairs on the same contig
+ */
+struct TraRead{
+    size_t mHash;    ///< hash of the pair
+    uint64_t mKey;   ///< <tile index, read ordinal in tile> of read, used to order reads with the same hash
+    int32_t mSpanID; ///< id of SV whose breakpoint is spanned by the second read, -1 for first read
+    uint8_t mQual;   ///< mapping quality of read
+    uint8_t mHap;    ///< haplotype of second read, 0 if not tagged, 1 if HP is 1, 2 otherwise
+    bool mFirst;     ///< read is the first read of pair
+
+    /** TraRead constructor */
+    TraRead(){}
+
+    /** TraRead constructor
+     * @param hash hash of the pair
+     * @param key <tile index, read ordinal in tile> of read
+     * @param spanID id of SV whose breakpoint is spanned by the second read, -1 for first read
+     * @param qual mapping quality of read
+     * @param hap haplotype of second read
+     */
+    TraRead(size_t hash, uint64_t key, int32_t spanID, uint8_t qual, uint8_t hap) :
+        mHash(hash), mKey(key), mSpanID(spanID), mQual(qual), mHap(hap), mFirst(spanID < 0) {}
+
+    /** operator to compare two TraRead, first reads are ordered before second reads of the same pair
+     * @param other reference of TraRead
+     * @return true if this is less than other
+     */
+    inline bool operator<(const TraRead& other) const {
+        if(mHash != other.mHash) return mHash < other.mHash;
+        if(mFirst != other.mFirst) return mFirst;
+        if(mKey != other.mKey) return mKey < other.mKey;
+        return mSpanID < other.mSpanID;
+    }
+};
+
+/** class to join inter-chromosomal pairs in external memory\n
+ * reads of each tile are sorted and appended to one temporary file as a run,\n
+ * runs are merged afterwards so reads of the same pair are read consecutively
+ */
+class TraSpill{
+    public:
+        FILE* mFp;                                      ///< temporary file to store runs
+        std::vector<std::pair<uint64_t, uint64_t>> mRuns; ///< <offset, count> of each run in mFp
+
+    private:
+        /** class to read one run in buffered chunks */
+        struct RunCursor{
+            uint64_t mOffset;          ///< offset of next chunk in mFp
+            uint64_t mLeft;            ///< reads not loaded into buffer
+            std::vector<TraRead> mBuf; ///< reads loaded
+            size_t mIdx;               ///< index of current read in mBuf
+        };
+
+        typedef std::pair<TraRead, uint32_t> HeapItem; ///< <current read, cursor index>
+
+        /** functor to order HeapItem in a min heap */
+        struct HeapGreater{
+            inline bool operator()(const HeapItem& a, const HeapItem& b) const {
+                return b.first < a.first;
+            }
+        };
+
+        std::vector<RunCursor> mCursors;                                                    ///< cursor of each run while merging
+        std::priority_queue<HeapItem, std::vector<HeapItem>, HeapGreater> mHeap;            ///< current read of each run while merging
+
+    public:
+        /** TraSpill constructor */
+        TraSpill(){
+            mFp = NULL;
+        }
+
+        /** TraSpill destructor */
+        ~TraSpill(){
+            if(mFp) fclose(mFp);
+        }
+
+        /** append reads as a run, reads are released afterwards
+         * @param reads sorted reads of one tile
+         */
+        void addRun(std::vector<TraRead>& reads);
+
+        /** start merging all runs added */
+        void rewind();
+
+        /** get next read in merged order
+         * @param r reference of TraRead to store the read
+         * @return true if one read got
+         */
+        bool next(TraRead& r);
+
+    private:
+        /** load next chunk of one run
+         * @param i index of run
+         * @return true if any read loaded
+         */
+        bool load(uint32_t i);
+};
+
+#endif